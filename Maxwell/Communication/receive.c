@@ -6,19 +6,28 @@
 #include <unistd.h>
 #include <sys/types.h> 
 #include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/time.h>
 #include <netinet/in.h>
 #include <pthread.h>
 #include "../Servo/motorControl.h"
+#include "../../Shared/trace.h"
+#include "../../Shared/protocol.h"
 
 #define PORTNO 51717
 #define MAXQUEUESIZE 10
+// bytes read ahead of the frame being decoded, several frames may come in one read
+#define RECEIVE_BUFFER_SIZE (16 * PROTOCOL_FRAME_SIZE)
+
+// Chrome trace written when Pascal sends exit, given as the second argument
+static const char *tracePath = NULL;
 
 pthread_mutex_t mutex1;
 pthread_cond_t dataReady;
 pthread_cond_t notFull;
 
 typedef struct node {
-    char *message;
+    protocolFrame_t frame;
     struct node *next;
 } node_t;
 
@@ -33,14 +42,15 @@ void initQueue(queue_t *queue) {
     queue->size = 0;
 }
 
-void enqueue(queue_t *queue, char *msg) {
+void enqueue(queue_t *queue, const protocolFrame_t *frame) {
     // add lock
     pthread_mutex_lock(&mutex1);
     while (queue->size >= MAXQUEUESIZE) {
         pthread_cond_wait(&notFull, &mutex1);
     }
     node_t *node = (node_t *)malloc(sizeof(node_t));
-    node->message = msg;
+    node->frame = *frame;
+    node->next = NULL;
     if (queue->head) {
         queue->tail->next = node;
         queue->tail = node;
@@ -51,7 +61,7 @@ void enqueue(queue_t *queue, char *msg) {
     queue->size++;
     node_t *tmp = queue->head;
     while(tmp) {
-        printf("%s\n", tmp->message);
+        printf("%s %u\n", protocolOpName(tmp->frame.op), tmp->frame.seq);
         tmp = tmp->next;
     }
     // signal
@@ -82,51 +92,38 @@ node_t *dequeue(queue_t *queue) {
     return NULL;
 }
 
-void decodePacket(char *packet, int len, char size[], char data[], char dist_angle[], char percentSpeed[]);
+// a stop or exit from Maxwell itself, when the link drops or closes
+static protocolFrame_t localFrame(protocolOp_t op) {
+    protocolFrame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.op = op;
+    return frame;
+}
 
 void *dequeueMessages(void *arg) {
     queue_t *queue = (queue_t *)arg;
+    traceThreadName("motors");
 
-    char buffer[256];
-    char size[10];
     char data[20];
-    char dist_angle[10];
-    char percentSpeed[10];
 
     while (1) {
-        memset(size, 0, 10);
-        memset(data, 0, 20);
-        memset(dist_angle, 0, 10);
-        memset(percentSpeed, 0, 10);
-        memset(buffer, 0, 256);
-        
         node_t *node = dequeue(queue);
-        printf("node message: %s\n", node->message);
-        memcpy(buffer, node->message, strlen(node->message));
-        // free(node);
-
-        decodePacket(buffer, strlen(buffer), size, data, dist_angle, percentSpeed);
-        float fdist_angle = 0;
-        float fpercentSpeed = 0.7;
-        if (strcmp(data, "error") == 0) {
-            memcpy(data, "stop", 4);
-        } else {
-            if (strcmp(dist_angle, "error") != 0) {
-                fdist_angle = atof(dist_angle);
-            }
-            if (strcmp(percentSpeed, "error") != 0) {
-                fpercentSpeed = atof(percentSpeed);
-            }
-        }
+        protocolFrame_t frame = node->frame;
+        free(node);
 
-        printf("%s %f %f\n", data, fdist_angle, fpercentSpeed);
+        // move() takes the op's word, frames only carry a checked op
+        snprintf(data, sizeof(data), "%s", protocolOpName(frame.op));
+        printf("%s %f %f\n", data, frame.value, frame.speed);
 
-        if (strcmp(data, "exit") == 0) {
+        if (frame.op == PROTOCOL_EXIT) {
             move("stop", 0, 0);
+            if (tracePath != NULL) {
+                traceDump(tracePath);
+            }
             break;
-        } else {
+        } else if (frame.op == PROTOCOL_DRIVE || frame.op == PROTOCOL_TURN || frame.op == PROTOCOL_STOP) {
             // call to drive motors in Servo/motorControl.cpp
-            move(data, fdist_angle, fpercentSpeed);
+            move(data, frame.value, frame.speed);
         }
     }
 }
@@ -138,41 +135,9 @@ void error(const char *msg) {
     exit(1);
 }
 
-// puts packet string into data array
-void getString (char *packet, char data[], int *index) {
-    int i = 0;
-    while (packet[*index] != '*') {
-        data[i] = packet[(*index)++];
-        i++;
-    }
-
-    data[i] = '\0';
-    *index += 4;
-
-    // check if data exists
-    if (data[0] == '\0') {
-        memcpy(data, "error", 5);
-    }
-}
-
-// Decodes received message and puts them into the respective char array
-void decodePacket(char *packet, int len, char size[], char data[], char dist_angle[], char percentSpeed[]) {
-    // printf("%s\n", packet);
-    if (packet[0] == '0' && packet[len-1] == '1') {
-        int index = 3;
-        getString(packet, size, &index);
-        getString(packet, data, &index);
-        getString(packet, dist_angle, &index);
-        getString(packet, percentSpeed, &index);
-    } else {
-        printf("%s\n", "segmented packet: Incorrect Start and End");
-    }
-}
-
 int main(int argc, char *argv[]) {
     int sockfd, newsockfd, portno;
     socklen_t clilen;
-    char buffer[256];
     struct sockaddr_in serv_addr, cli_addr;
     int n;
 
@@ -183,6 +148,9 @@ int main(int argc, char *argv[]) {
     } else {
        defaultPort = atoi(argv[1]);
     }
+    if (argc > 2) {
+        tracePath = argv[2];
+    }
 
     sockfd = socket(AF_INET, SOCK_STREAM, 0);
 
@@ -228,23 +196,106 @@ int main(int argc, char *argv[]) {
     initQueue(queue);
     pthread_create(&(tid[1]), NULL, dequeueMessages, queue);
 
+    // the watchdog is armed by the first valid frame, whatever its op
+    int armed = 0;
+    int linkLost = 0;
+    // bytes skipped since the last valid frame, and why the first one was
+    size_t dropped = 0;
+    protocolError_t dropReason = PROTOCOL_OK;
+    long lastSeq = -1;
+    // set once an exit is queued, the motor thread takes nothing after it
+    int exiting = 0;
+    uint8_t pending[RECEIVE_BUFFER_SIZE];
+    size_t have = 0;
     while (1) {
-
-        memset(buffer, 0, 256);
+        if (armed) {
+            fd_set readable;
+            FD_ZERO(&readable);
+            FD_SET(newsockfd, &readable);
+            struct timeval timeout;
+            timeout.tv_sec = PROTOCOL_LINK_TIMEOUT_MS / 1000;
+            timeout.tv_usec = (PROTOCOL_LINK_TIMEOUT_MS % 1000) * 1000;
+            int ready = select(newsockfd + 1, &readable, NULL, NULL, &timeout);
+            if (ready < 0) {
+                error("ERROR waiting on socket");
+            }
+            if (ready == 0) {
+                if (!linkLost) {
+                    printf("%s\n", "no frame from Pascal, link lost, stopping");
+                    protocolFrame_t stop = localFrame(PROTOCOL_STOP);
+                    enqueue(queue, &stop);
+                    linkLost = 1;
+                }
+                continue;
+            }
+        }
 
         // read data
-        // n = read(newsockfd,buffer,255);
-        n = read(newsockfd, buffer, sizeof(buffer));
-
-        enqueue(queue, buffer);
-        usleep(1000);
+        n = read(newsockfd, pending + have, sizeof(pending) - have);
 
         if (n < 0) {
             error("ERROR reading from socket");
         }
+        if (n == 0) {
+            // stops the motors and ends the motor thread like an exit from Pascal
+            printf("%s\n", "Pascal closed the link");
+            protocolFrame_t closed = localFrame(PROTOCOL_EXIT);
+            enqueue(queue, &closed);
+            pthread_join(tid[1], NULL);
+            break;
+        }
+        have += n;
+
+        // Whole frames only. After a bad one, step a byte at a time until the
+        // next frame's magic and checksum line up again.
+        size_t used = 0;
+        while (have - used >= PROTOCOL_FRAME_SIZE) {
+            protocolFrame_t frame;
+            protocolError_t result;
+            {
+                TRACE_SCOPE("decodeFrame");
+                result = decodeFrame(pending + used, have - used, &frame);
+            }
+            if (result != PROTOCOL_OK) {
+                if (dropped == 0) {
+                    dropReason = result;
+                }
+                dropped++;
+                used++;
+                continue;
+            }
+            used += PROTOCOL_FRAME_SIZE;
+            armed = 1;
 
-        printf("Here is the message: %s\n", buffer);
+            // one line per resync, not per byte
+            if (dropped > 0) {
+                printf("dropped %zu bytes to resync, %s\n", dropped, protocolErrorName(dropReason));
+                dropped = 0;
+            }
 
+            if (linkLost) {
+                printf("%s\n", "link restored");
+                linkLost = 0;
+            }
+            if (lastSeq >= 0 && frame.seq != (uint32_t)(lastSeq + 1)) {
+                printf("frame %u after %ld\n", frame.seq, lastSeq);
+            }
+            lastSeq = frame.seq;
+            if (frame.op != PROTOCOL_HEARTBEAT && frame.op != PROTOCOL_NONE) {
+                enqueue(queue, &frame);
+            }
+            if (frame.op == PROTOCOL_EXIT) {
+                exiting = 1;
+                break;
+            }
+        }
+        // frames behind an exit would fill the queue with no one left to drain it
+        if (exiting) {
+            pthread_join(tid[1], NULL);
+            break;
+        }
+        memmove(pending, pending + used, have - used);
+        have -= used;
     }
 
     close(newsockfd);
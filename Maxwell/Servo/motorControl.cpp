@@ -9,6 +9,7 @@
 #include <libusb-1.0/libusb.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include "../../Shared/trace.h"
 
 
 using namespace std;
@@ -19,14 +20,17 @@ int startMotors (libusb_device_handle *handle, float speed) {
 	int r;
 	// Assumed 4 servos
 	for (int i = 0; i < 8; i+=2) {
-			r = libusb_control_transfer( handle,
-							0x40,	  //request type
-							0x85,	  //request
-							4*speed,  //speed/value
-							i,		  //servo number
-							NULL,
-							0,
-							5000);
+			{
+				TRACE_SCOPE("libusb_control_transfer");
+				r = libusb_control_transfer( handle,
+								0x40,	  //request type
+								0x85,	  //request
+								4*speed,  //speed/value
+								i,		  //servo number
+								NULL,
+								0,
+								5000);
+			}
 			if (r < 0) {
 				cout << "Error starting motor " << i << endl;
 				return -1;
@@ -87,14 +91,17 @@ int motorOneDirection (libusb_device_handle *handle, float rSpeed, float lSpeed)
 	// 			NULL,
 	// 			0,
 	// 			5000);
-	r = libusb_control_transfer( handle,
-				0x40,	  //request type
-				0x85,	  //request
-				4*rSpeed,  //speed/value
-				0,		  //servo number
-				NULL,
-				0,
-				5000);
+	{
+		TRACE_SCOPE("libusb_control_transfer");
+		r = libusb_control_transfer( handle,
+					0x40,	  //request type
+					0x85,	  //request
+					4*rSpeed,  //speed/value
+					0,		  //servo number
+					NULL,
+					0,
+					5000);
+	}
 	// r = f1.get()
 	if (r < 0) {
 		cout << "Error starting motor " << 0 << endl;
@@ -116,14 +123,17 @@ int motorOneDirection (libusb_device_handle *handle, float rSpeed, float lSpeed)
 	// 			NULL,
 	// 			0,
 	// 			5000);
-	r = libusb_control_transfer( handle,
-				0x40,	  //request type
-				0x85,	  //request
-				4*lSpeed,  //speed/value
-				4,		  //servo number
-				NULL,
-				0,
-				5000);
+	{
+		TRACE_SCOPE("libusb_control_transfer");
+		r = libusb_control_transfer( handle,
+					0x40,	  //request type
+					0x85,	  //request
+					4*lSpeed,  //speed/value
+					4,		  //servo number
+					NULL,
+					0,
+					5000);
+	}
 	// r = f2.get()
 	if (r < 0) {
 		cout << "Error starting motor " << 2 << endl;
@@ -139,26 +149,32 @@ int motorOneDirection (libusb_device_handle *handle, float rSpeed, float lSpeed)
 int motorTurn (libusb_device_handle *handle, float rSpeed, float lSpeed) {
 	int r;
 	// Assumed 4 servos
-	r = libusb_control_transfer( handle,
-				0x40,	  //request type
-				0x85,	  //request
-				4*rSpeed, //speed/value
-				0,		  //servo number
-				NULL,
-				0,
-				5000);
+	{
+		TRACE_SCOPE("libusb_control_transfer");
+		r = libusb_control_transfer( handle,
+					0x40,	  //request type
+					0x85,	  //request
+					4*rSpeed, //speed/value
+					0,		  //servo number
+					NULL,
+					0,
+					5000);
+	}
 	if (r < 0) {
 		cout << "Error starting motor " << 0 << endl;
 		return -1;
 	}
-	r = libusb_control_transfer( handle,
-				0x40,	  //request type
-				0x85,	  //request
-				4*lSpeed, //speed/value
-				4,		  //servo number
-				NULL,
-				0,
-				5000);
+	{
+		TRACE_SCOPE("libusb_control_transfer");
+		r = libusb_control_transfer( handle,
+					0x40,	  //request type
+					0x85,	  //request
+					4*lSpeed, //speed/value
+					4,		  //servo number
+					NULL,
+					0,
+					5000);
+	}
 	if (r < 0) {
 		cout << "Error starting motor " << 2 << endl;
 		return -1;
@@ -307,14 +323,20 @@ int main(int argc, char *argv[]) {
 		return -1;
 	}
 
-	handle = libusb_open_device_with_vid_pid(ctx, vid, pid);
+	{
+		TRACE_SCOPE("libusb_open");
+		handle = libusb_open_device_with_vid_pid(ctx, vid, pid);
+	}
 
 	if (!handle) {
 		cout << "Error: handle incorrect" << endl;
 		return -1;
 	}
 
-	r = libusb_claim_interface(handle, 0);
+	{
+		TRACE_SCOPE("libusb_claim_interface");
+		r = libusb_claim_interface(handle, 0);
+	}
 
 	if (strcmp(action, "stop") == 0) {
 		startMotors(handle, 0);	
@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include "../Globals/externals.h"
+#include "../Globals/channel.h"
+
+using namespace std;
+
+#define BENCH_COMMANDS 5000
+#define BENCH_STREAM_COMMANDS 1000000
+// between two commands in the paced run, us, long enough for the sender to fall asleep
+#define BENCH_PERIOD_US 200
+
+typedef chrono::steady_clock benchClock;
+
+// the same calls on both queues, a MOTOR_EXIT command ends a run
+static void put(BoundedBuffer *queue, const motorCommand_t &command) {
+	queue->deposit(command);
+}
+
+static motorCommand_t take(BoundedBuffer *queue) {
+	return queue->fetch();
+}
+
+static void put(Channel<motorCommand_t, COMMAND_CHANNEL_SIZE> *queue, const motorCommand_t &command) {
+	motorCommand_t copy = command;
+	queue->push(copy);
+}
+
+static motorCommand_t take(Channel<motorCommand_t, COMMAND_CHANNEL_SIZE> *queue) {
+	motorCommand_t command = motorCommand(MOTOR_EXIT);
+	queue->pop(&command);
+	return command;
+}
+
+static void put(CommandMailbox *queue, const motorCommand_t &command) {
+	queue->post(command);
+}
+
+static motorCommand_t take(CommandMailbox *queue) {
+	motorCommand_t command = motorCommand(MOTOR_EXIT);
+	queue->take(&command);
+	return command;
+}
+
+static double percentile(const vector<double> &sorted, double p) {
+	if (sorted.empty()) {
+		return 0;
+	}
+	size_t i = (size_t)ceil(p / 100 * sorted.size());
+	return sorted[i > 0 ? i - 1 : 0];
+}
+
+// The vision loop's pattern: one command now and then, with the sender thread
+// idle in between. Latency is from before the push to after the pop, us.
+// Commands the mailbox replaced before they were taken are left out.
+template <typename Queue>
+static void pacedRun(const char *name, Queue *queue, int commands, int periodUs) {
+	vector<benchClock::time_point> pushed(commands);
+	vector<benchClock::time_point> popped(commands);
+
+	thread sender([queue, &popped]() {
+		while (true) {
+			motorCommand_t command = take(queue);
+			if (command.op == MOTOR_EXIT) {
+				break;
+			}
+			popped[(int)command.value] = benchClock::now();
+		}
+	});
+
+	for (int i = 0; i < commands; i++) {
+		this_thread::sleep_for(chrono::microseconds(periodUs));
+		pushed[i] = benchClock::now();
+		put(queue, motorCommand(MOTOR_DRIVE, i, 0.7));
+	}
+	put(queue, motorCommand(MOTOR_EXIT));
+	sender.join();
+
+	vector<double> latencies;
+	double sum = 0;
+	for (int i = 0; i < commands; i++) {
+		if (popped[i] > pushed[i]) {
+			latencies.push_back(chrono::duration<double, micro>(popped[i] - pushed[i]).count());
+			sum += latencies.back();
+		}
+	}
+	if (latencies.empty()) {
+		return;
+	}
+	sort(latencies.begin(), latencies.end());
+	printf("  %-14s %8.2f %8.2f %8.2f %8.2f %8.2f  %d missed\n", name, sum / latencies.size(), percentile(latencies, 50),
+		   percentile(latencies, 90), percentile(latencies, 99), latencies.back(), commands - (int)latencies.size());
+}
+
+// Both threads flat out, so the queue is mostly full or empty and its waits dominate.
+template <typename Queue>
+static void streamRun(const char *name, Queue *queue, int commands) {
+	long received = 0;
+
+	benchClock::time_point start = benchClock::now();
+	thread sender([queue, &received]() {
+		while (take(queue).op != MOTOR_EXIT) {
+			received++;
+		}
+	});
+	for (int i = 0; i < commands; i++) {
+		put(queue, motorCommand(MOTOR_TURN, i, 0.7));
+	}
+	put(queue, motorCommand(MOTOR_EXIT));
+	sender.join();
+	double seconds = chrono::duration<double>(benchClock::now() - start).count();
+
+	printf("  %-14s %8.2f Mcommands/s, %.0f ns per command\n", name, received / seconds / 1e6,
+		   seconds * 1e9 / received);
+}
+
+static void usage() {
+	cout << "usage: channelBench [-n commands] [-p period-us] [-s stream-commands]" << endl;
+}
+
+// Hands motor commands from this thread to a sender thread through the old
+// BoundedBuffer, the Channel that replaced it and the latest-value
+// CommandMailbox. The queues hold COMMAND_CHANNEL_SIZE commands like the real
+// command path, the mailbox is only timed on paced commands since it keeps
+// just the newest one when streaming.
+int main(int argc, char *argv[]) {
+	int commands = BENCH_COMMANDS;
+	int periodUs = BENCH_PERIOD_US;
+	int streamCommands = BENCH_STREAM_COMMANDS;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			commands = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+			periodUs = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			streamCommands = atoi(argv[++i]);
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (commands <= 0 || streamCommands <= 0 || periodUs < 0) {
+		usage();
+		return 1;
+	}
+
+	printf("handoff every %d us, %d commands\n", periodUs, commands);
+	printf("  %-14s %8s %8s %8s %8s %8s\n", "us", "mean", "p50", "p90", "p99", "max");
+	{
+		BoundedBuffer buffer(COMMAND_CHANNEL_SIZE);
+		pacedRun("BoundedBuffer", &buffer, commands, periodUs);
+	}
+	{
+		Channel<motorCommand_t, COMMAND_CHANNEL_SIZE> channel;
+		pacedRun("Channel", &channel, commands, periodUs);
+	}
+	{
+		CommandMailbox mailbox;
+		pacedRun("CommandMailbox", &mailbox, commands, periodUs);
+	}
+
+	printf("streaming %d commands\n", streamCommands);
+	{
+		BoundedBuffer buffer(COMMAND_CHANNEL_SIZE);
+		streamRun("BoundedBuffer", &buffer, streamCommands);
+	}
+	{
+		Channel<motorCommand_t, COMMAND_CHANNEL_SIZE> channel;
+		streamRun("Channel", &channel, streamCommands);
+	}
+
+	return 0;
+}
@@ -0,0 +1,336 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <opencv2/opencv.hpp>
+#include "../Vision/motionTrack.h"
+#include "../Globals/externals.h"
+#include "../../Shared/trace.h"
+
+using namespace cv;
+using namespace std;
+
+#define BENCH_CAPTURE 0
+#define BENCH_SEGMENT 1
+#define BENCH_DETECT 2
+#define BENCH_STATECHART 3
+#define BENCH_TOTAL 4
+#define BENCH_STEPS 5
+
+static const char *stepNames[BENCH_STEPS] = {"capture", "segment", "detect", "statechart", "total"};
+
+// most the -y masks may differ from the exact HSV ones, % of the pixels either sets.
+// A smoke check on real footage only, it depends on how many of the frame's colours
+// sit near a range edge. yuvLutTest bounds the table per colour.
+#define BENCH_YUV_TOLERANCE 5.0
+
+// per step latencies of every frame, ms
+typedef struct {
+	vector<double> latencies[BENCH_STEPS];
+	int frames;
+	int found;
+	double seconds;
+	uint64_t detectionSum;
+	uint64_t commandSum;
+	long maskDiffer;	// pixels only one of the YUV and HSV masks sets
+	long maskEither;
+} benchResult_t;
+
+// scratch of the YUV against HSV comparison
+typedef struct {
+	Mat bgr;
+	blurWorkspace_t blur;
+	vector<BitMask> yuvMasks;
+	vector<BitMask> hsvMasks;
+} compareWorkspace_t;
+
+// FNV-1a, enough to tell whether two runs gave the same outputs
+static void hashBytes(uint64_t *hash, const void *data, size_t size) {
+	const unsigned char *bytes = (const unsigned char *)data;
+	for (size_t i = 0; i < size; i++) {
+		*hash ^= bytes[i];
+		*hash *= 1099511628211ULL;
+	}
+}
+
+// hashed to a hundredth of a pixel, so printing or summing order cannot change it
+static void hashFloat(uint64_t *hash, float value) {
+	int32_t fixed = isnan(value) ? INT32_MIN : (int32_t)lround(value * 100);
+	hashBytes(hash, &fixed, sizeof(fixed));
+}
+
+// Segments a YUYV frame both ways, straight from YUV and converted to BGR then
+// thresholded exactly in HSV, and counts where the raw masks disagree.
+static void compareYUV(const captureFrame_t &captured, const colorTargets_t &yuvTargets, const colorTargets_t &hsvTargets,
+					   benchResult_t *result, compareWorkspace_t *work) {
+	Mat yuyv = captured.image;
+	frameToBGR(captured, &work->bgr);
+	segmentFrame(&yuyv, yuvTargets, &work->yuvMasks, &work->blur);
+	segmentFrame(&work->bgr, hsvTargets, &work->hsvMasks, &work->blur);
+
+	for (int t = 0; t < work->yuvMasks.size(); t++) {
+		const vector<uint64_t> &a = work->yuvMasks[t].words;
+		const vector<uint64_t> &b = work->hsvMasks[t].words;
+		for (int i = 0; i < a.size(); i++) {
+			result->maskDiffer += __builtin_popcountll(a[i] ^ b[i]);
+			result->maskEither += __builtin_popcountll(a[i] | b[i]);
+		}
+	}
+}
+
+static double maskDifference(const benchResult_t *result) {
+	return result->maskEither > 0 ? 100.0 * result->maskDiffer / result->maskEither : 0;
+}
+
+static double elapsedMs(chrono::steady_clock::time_point start, chrono::steady_clock::time_point end) {
+	return chrono::duration<double, milli>(end - start).count();
+}
+
+static double percentile(const vector<double> &sorted, double p) {
+	if (sorted.empty()) {
+		return 0;
+	}
+	size_t i = (size_t)ceil(p / 100 * sorted.size());
+	return sorted[i > 0 ? i - 1 : 0];
+}
+
+static bool endsWith(const char *name, const char *suffix) {
+	size_t n = strlen(name);
+	size_t m = strlen(suffix);
+	return n >= m && strcmp(name + n - m, suffix) == 0;
+}
+
+// Runs every frame of one recording through the same steps as the pipeline,
+// one after the other. Raw .yuv recordings are read like -v reads them,
+// anything else is decoded by OpenCV. With the YUV engine the raw frames are
+// also checked against exact HSV segmentation with hsvTargets, off the clock.
+static bool benchFile(const char *path, const colorTargets_t &targets, const colorTargets_t &hsvTargets, benchResult_t *result) {
+	VideoCapture cap;
+	FileCapture recording;
+	bool isRaw = endsWith(path, ".yuv") || endsWith(path, ".raw");
+	double fps = 30;
+
+	if (isRaw) {
+		if (!recording.open(path, CAPTURE_WIDTH, CAPTURE_HEIGHT)) {
+			return false;
+		}
+	} else {
+		if (!cap.open(path)) {
+			cout << "Error opening " << path << endl;
+			return false;
+		}
+		if (cap.get(CV_CAP_PROP_FPS) > 0) {
+			fps = cap.get(CV_CAP_PROP_FPS);
+		}
+	}
+
+	framePacket_t packet;
+	trackShare_t share;
+	segmentWorkspace_t segmentWork;
+	detectState_t state;
+	compareWorkspace_t compareWork;
+	initTrackShare(&share);
+	initDetectState(&state);
+
+	chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+	for (int n = 0; ; n++) {
+		chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+		bool grabbed;
+		if (isRaw) {
+			grabbed = recording.grab(&packet.captured);
+			if (grabbed && targets.engine == SEGMENT_YUV) {
+				packet.frame = packet.captured.image;
+			} else if (grabbed) {
+				frameToBGR(packet.captured, &packet.frame);
+			}
+		} else {
+			grabbed = cap.read(packet.frame);
+			// timestamps from the frame rate, so the tracker sees the same steps every run
+			packet.captured.index = -1;
+			packet.captured.timestampUs = (int64_t)(n * 1000000 / fps) + 1;
+		}
+		if (!grabbed || packet.frame.empty()) {
+			break;
+		}
+
+		chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+		segmentPacket(&packet, targets, &share, &segmentWork);
+		chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+		detectPacket(&packet, &share, &state, NULL);
+		chrono::steady_clock::time_point t3 = chrono::steady_clock::now();
+		motorCommand_t output = decidePacket(&packet, &share);
+		chrono::steady_clock::time_point t4 = chrono::steady_clock::now();
+
+		if (isRaw) {
+			if (targets.engine == SEGMENT_YUV) {
+				compareYUV(packet.captured, targets, hsvTargets, result, &compareWork);
+			}
+			recording.release(&packet.captured);
+		}
+
+		result->latencies[BENCH_CAPTURE].push_back(elapsedMs(t0, t1));
+		result->latencies[BENCH_SEGMENT].push_back(elapsedMs(t1, t2));
+		result->latencies[BENCH_DETECT].push_back(elapsedMs(t2, t3));
+		result->latencies[BENCH_STATECHART].push_back(elapsedMs(t3, t4));
+		result->latencies[BENCH_TOTAL].push_back(elapsedMs(t0, t4));
+
+		hashFloat(&result->detectionSum, packet.objectPoint.x);
+		hashFloat(&result->detectionSum, packet.objectPoint.y);
+		hashFloat(&result->detectionSum, packet.objectRadius);
+		hashFloat(&result->detectionSum, packet.destPoint.x);
+		hashFloat(&result->detectionSum, packet.destPoint.y);
+		hashFloat(&result->detectionSum, packet.destRadius);
+		hashBytes(&result->detectionSum, &packet.isOffscreen, sizeof(packet.isOffscreen));
+		hashBytes(&result->detectionSum, &packet.direction, sizeof(packet.direction));
+		hashBytes(&result->commandSum, &output.op, sizeof(output.op));
+		hashFloat(&result->commandSum, output.value);
+		hashFloat(&result->commandSum, output.speed);
+
+		result->frames++;
+		if (!packet.isOffscreen) {
+			result->found++;
+		}
+	}
+	result->seconds += elapsedMs(begin, chrono::steady_clock::now()) / 1000;
+
+	cap.release();
+	recording.close();
+	return true;
+}
+
+static void initResult(benchResult_t *result) {
+	result->frames = 0;
+	result->found = 0;
+	result->seconds = 0;
+	result->detectionSum = 14695981039346656037ULL;
+	result->commandSum = 14695981039346656037ULL;
+	result->maskDiffer = 0;
+	result->maskEither = 0;
+}
+
+static void report(const char *name, benchResult_t *result) {
+	printf("%s: %d frames, %.1f fps, object found in %d\n", name, result->frames,
+		   result->seconds > 0 ? result->frames / result->seconds : 0, result->found);
+	printf("  %-10s %8s %8s %8s %8s %8s\n", "ms", "mean", "p50", "p90", "p99", "max");
+	for (int s = 0; s < BENCH_STEPS; s++) {
+		vector<double> &sorted = result->latencies[s];
+		double sum = 0;
+		sort(sorted.begin(), sorted.end());
+		for (int i = 0; i < sorted.size(); i++) {
+			sum += sorted[i];
+		}
+		printf("  %-10s %8.3f %8.3f %8.3f %8.3f %8.3f\n", stepNames[s], sorted.empty() ? 0 : sum / sorted.size(),
+			   percentile(sorted, 50), percentile(sorted, 90), percentile(sorted, 99), sorted.empty() ? 0 : sorted.back());
+	}
+	printf("  detections %016llx commands %016llx\n", (unsigned long long)result->detectionSum,
+		   (unsigned long long)result->commandSum);
+	if (result->maskEither > 0) {
+		printf("  yuv masks differ from hsv in %.2f%% of their pixels, tolerance %.2f%%\n",
+			   maskDifference(result), BENCH_YUV_TOLERANCE);
+	}
+}
+
+static void usage() {
+	cout << "usage: visionBench [-o Object-HSV.txt] [-d Destination-HSV.txt] [-t] [-p level] [-l] [-y] [-u] [-T trace.json] recording..." << endl;
+	cout << "recordings are any video OpenCV reads, or raw 640x480 YUYV frames ending in .yuv or .raw" << endl;
+	cout << "-y segments raw recordings in YUV and fails when its masks stray from HSV's past the tolerance" << endl;
+}
+
+// Replays recordings through segmentation, detection and the statechart with
+// no window and no prompts, for comparing the pipeline's speed and outputs
+// between builds. The statechart keeps its state from one recording to the
+// next, so compare runs over the same list of files.
+int main(int argc, char *argv[]) {
+	const char *objectFile = "Object-HSV.txt";
+	const char *destFile = "Destination-HSV.txt";
+	vector<const char *> recordings;
+
+	headlessMode = true;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			objectFile = argv[++i];
+		} else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+			destFile = argv[++i];
+		} else if (strcmp(argv[i], "-t") == 0) {
+			trackMode = true;
+		} else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+			pyramidLevel = atoi(argv[++i]);
+			if (pyramidLevel < 0 || pyramidLevel > PYRAMID_MAX_LEVEL) {
+				cout << "-p takes a pyramid level from 0 to " << PYRAMID_MAX_LEVEL << endl;
+				return 1;
+			}
+		} else if (strcmp(argv[i], "-l") == 0) {
+			lutMode = true;
+		} else if (strcmp(argv[i], "-y") == 0) {
+			yuvMode = true;
+		} else if (strcmp(argv[i], "-u") == 0) {
+			changeMode = true;
+		} else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+			tracePath = argv[++i];
+		} else if (argv[i][0] == '-') {
+			usage();
+			return 1;
+		} else {
+			recordings.push_back(argv[i]);
+		}
+	}
+	if (recordings.empty()) {
+		usage();
+		return 1;
+	}
+	// -u keeps its own full frame tile cache, so it cannot search windows or a coarse level
+	if (changeMode && (trackMode || pyramidLevel > 0)) {
+		cout << "-u cannot be combined with -t or -p" << endl;
+		return 1;
+	}
+
+	vector<hsvRange_t> ranges(2);
+	if (!loadHSV(objectFile, &ranges[OBJECT_TARGET].lowerBound, &ranges[OBJECT_TARGET].upperBound) ||
+		!loadHSV(destFile, &ranges[DEST_TARGET].lowerBound, &ranges[DEST_TARGET].upperBound)) {
+		cout << "Error reading HSV bounds from " << objectFile << " and " << destFile << endl;
+		return 1;
+	}
+
+	colorTargets_t targets;
+	colorTargets_t hsvTargets;
+	setColorTargets(&targets, ranges, yuvMode ? SEGMENT_YUV : lutMode ? SEGMENT_LUT : SEGMENT_HSV);
+	setColorTargets(&hsvTargets, ranges, SEGMENT_HSV);
+
+	benchResult_t total;
+	initResult(&total);
+	for (int i = 0; i < recordings.size(); i++) {
+		benchResult_t result;
+		initResult(&result);
+		if (!benchFile(recordings[i], targets, hsvTargets, &result)) {
+			return 1;
+		}
+		report(recordings[i], &result);
+
+		for (int s = 0; s < BENCH_STEPS; s++) {
+			total.latencies[s].insert(total.latencies[s].end(), result.latencies[s].begin(), result.latencies[s].end());
+		}
+		total.frames += result.frames;
+		total.found += result.found;
+		total.seconds += result.seconds;
+		hashBytes(&total.detectionSum, &result.detectionSum, sizeof(result.detectionSum));
+		hashBytes(&total.commandSum, &result.commandSum, sizeof(result.commandSum));
+		total.maskDiffer += result.maskDiffer;
+		total.maskEither += result.maskEither;
+	}
+	if (recordings.size() > 1) {
+		report("all", &total);
+	}
+	if (tracePath != NULL) {
+		traceDump(tracePath);
+	}
+	if (maskDifference(&total) > BENCH_YUV_TOLERANCE) {
+		cout << "YUV segmentation is outside its tolerance of HSV" << endl;
+		return 2;
+	}
+	return 0;
+}
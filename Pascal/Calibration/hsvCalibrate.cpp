@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "../Vision/autoCalibrate.h"
+#include "../Vision/v4l2Capture.h"
+#include "../Vision/calibrationProfile.h"
+
+using namespace cv;
+using namespace std;
+
+// frames dropped first while the camera's exposure settles
+#define CALIBRATE_WARMUP 5
+// frames read per frame asked for before giving up on seeing the target
+#define CALIBRATE_MAX_TRIES 10
+
+static void usage(const char *name) {
+	cout << "Usage: " << name << " [-v device|recording] [-r x,y,w,h] [-n frames] [-p percentile] output-file" << endl;
+	cout << "       " << name << " [options] -P profile [-d] [-C profile-file]" << endl;
+	cout << "Without -r the largest strongly coloured blob in view is sampled." << endl;
+	cout << "-P stores the range as the profile's object, or with -d its destination." << endl;
+}
+
+static bool endsWith(const char *name, const char *suffix) {
+	size_t n = strlen(name);
+	size_t m = strlen(suffix);
+	return n >= m && strcmp(name + n - m, suffix) == 0;
+}
+
+// Learns the HSV range of whatever is held in front of the camera and writes it
+// in the format of Object-HSV.txt and Destination-HSV.txt, no window needed.
+int main(int argc, char *argv[]) {
+	const char *path = NULL;
+	const char *output = NULL;
+	const char *profileName = NULL;
+	bool isDestination = false;
+	Rect region;
+	int frames = CALIBRATE_FRAMES;
+	double percentile = CALIBRATE_PERCENTILE;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-v") == 0 && i + 1 < argc) {
+			path = argv[++i];
+		} else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+			if (sscanf(argv[++i], "%d,%d,%d,%d", &region.x, &region.y, &region.width, &region.height) != 4) {
+				usage(argv[0]);
+				return -1;
+			}
+		} else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			frames = max(atoi(argv[++i]), 1);
+		} else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+			percentile = min(max(atof(argv[++i]), 1.0), 100.0);
+		} else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc) {
+			profileName = argv[++i];
+		} else if (strcmp(argv[i], "-C") == 0 && i + 1 < argc) {
+			profilePath = argv[++i];
+		} else if (strcmp(argv[i], "-d") == 0) {
+			isDestination = true;
+		} else if (argv[i][0] != '-' && output == NULL) {
+			output = argv[i];
+		} else {
+			usage(argv[0]);
+			return -1;
+		}
+	}
+	if (output == NULL && profileName == NULL) {
+		usage(argv[0]);
+		return -1;
+	}
+
+	// same sources as sendToBB8: raw recordings and /dev/ paths through our own
+	// capture, anything else through OpenCV, and without -v camera 1 then 0
+	VideoCapture cap;
+	V4L2Capture camera;
+	FileCapture recording;
+	FrameSource *source = NULL;
+	if (path != NULL && (endsWith(path, ".yuv") || endsWith(path, ".raw"))) {
+		if (!recording.open(path, CAPTURE_WIDTH, CAPTURE_HEIGHT)) {
+			return -1;
+		}
+		source = &recording;
+	} else if (path != NULL && strncmp(path, "/dev/", 5) == 0) {
+		if (!camera.open(path, CAPTURE_WIDTH, CAPTURE_HEIGHT)) {
+			return -1;
+		}
+		source = &camera;
+	} else if (path != NULL) {
+		if (!cap.open(path)) {
+			cout << "Error opening " << path << endl;
+			return -1;
+		}
+	} else if (!cap.open(1) && !cap.open(0)) {
+		cout << "Error detecting camera" << endl;
+		return -1;
+	}
+
+	hsvHistogram_t histogram;
+	calibrateWorkspace_t work;
+	captureFrame_t captured;
+	Mat frame;
+	clearHistogram(&histogram);
+
+	// bounded, a camera that never sees the target would otherwise be read forever
+	int sampled = 0;
+	int n = 0;
+	for (; sampled < frames && n < CALIBRATE_WARMUP + frames * CALIBRATE_MAX_TRIES; n++) {
+		bool grabbed;
+		if (source != NULL) {
+			grabbed = source->grab(&captured);
+			if (grabbed) {
+				frameToBGR(captured, &frame);
+				source->release(&captured);
+			}
+		} else {
+			grabbed = cap.read(frame);
+		}
+		if (!grabbed || frame.empty()) {
+			break;
+		}
+		// a recording starts where it was cut, only a live camera needs to settle
+		if (path == NULL || source == &camera) {
+			if (n < CALIBRATE_WARMUP) {
+				continue;
+			}
+		}
+
+		if (sampleFrame(frame, region, &histogram, &work) > 0) {
+			sampled++;
+		}
+	}
+	if (source != NULL) {
+		source->close();
+	}
+	cap.release();
+
+	// nothing is written then, the old range or profile stays as it was
+	if (sampled == 0 || histogram.total == 0) {
+		cout << "Error: no target found in " << n << " frames, hold the target closer or give a region with -r" << endl;
+		return -1;
+	}
+
+	hsvRange_t range;
+	histogramBounds(histogram, percentile, &range);
+	if (output != NULL && !saveHSV(output, range)) {
+		cout << "Error writing " << output << endl;
+		return -1;
+	}
+	if (profileName != NULL) {
+		// the rest of the profile is kept, a missing profile starts from the defaults
+		vector<calibrationProfile_t> profiles;
+		calibrationProfile_t profile;
+		// a file that is there but unreadable is left alone rather than overwritten
+		if (!loadProfiles(profilePath, &profiles) && ifstream(profilePath)) {
+			return -1;
+		}
+		defaultProfile(&profile, profileName);
+		for (size_t i = 0; i < profiles.size(); i++) {
+			if (profiles[i].name == profile.name) {
+				profile = profiles[i];
+			}
+		}
+		if (isDestination) {
+			profile.destination = range;
+		} else {
+			profile.object = range;
+		}
+		storeProfile(&profiles, profile);
+		if (!saveProfiles(profilePath, profiles)) {
+			cout << "Error writing " << profilePath << endl;
+			return -1;
+		}
+	}
+
+	cout << (output != NULL ? output : profileName) << ": H " << range.lowerBound[0] << "-" << range.upperBound[0]
+		<< " S " << range.lowerBound[1] << "-" << range.upperBound[1]
+		<< " V " << range.lowerBound[2] << "-" << range.upperBound[2]
+		<< " from " << histogram.total << " pixels in " << sampled << " frames" << endl;
+	return 0;
+}
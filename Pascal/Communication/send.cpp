@@ -11,12 +11,14 @@
 #include <condition_variable>
 #include "../Vision/motionTrack.h"
 #include "../Globals/externals.h"
+#include "../Vision/calibrationProfile.h"
+#include "../../Shared/trace.h"
+#include "../../Shared/protocol.h"
 
 #define PORT 51717
 
 // current ip of Maxwell Board, DO NOT CHANGE
 static char *ip = "192.168.42.1";
-BoundedBuffer bBuffer(2);
 
 void error(const char *msg)
 {
@@ -24,84 +26,24 @@ void error(const char *msg)
     exit(0);
 }
 
-// convert int to string up to nine digits
-// Does not accomodate for leading zeros, or numbers greater than 10 digits
-void itoa(int num, char *str) {
-    int copy = num;
-    int numDigits = 0;
-    int negative = 0;
-    int base = 1;
+static_assert(PROTOCOL_NONE == (int)MOTOR_NONE && PROTOCOL_EXIT == (int)MOTOR_EXIT, "protocol ops follow motorOp_t");
 
-    if (num < 0) {
-        negative = 1;
-    }
-
-    while (copy) {
-        base *= 10;
-        copy = copy / 10;
-        numDigits++;
-    }
-
-    base /= 10;
-
-    memset(str, 0, strlen(str));
-    copy = num;
-    if (numDigits > 9) {
-        printf("%s\n", "Floating point exception, defaulting to 0");
-        strcat(str, "0");
-        return;
-    }
-
-    if (num == 0) {
-        strcat(str, "0");
-        return;
-    }
-
-    if (negative) {
-        copy *= -1;
-        strcat(str, "-");
-    }
-
-    int index = negative;
-    int i;
-    for (i = 0; i < numDigits; i++) {
-        char charToAppend = copy/base + '0';
-        str[index++] = charToAppend;
-        copy %= base;
-        base /= 10;
+// writes the whole frame, TCP may take it in pieces
+static bool writeFrame(int sockfd, const uint8_t *frame) {
+    size_t written = 0;
+    while (written < PROTOCOL_FRAME_SIZE) {
+        ssize_t n = write(sockfd, frame + written, PROTOCOL_FRAME_SIZE - written);
+        if (n < 0) {
+            return false;
+        }
+        written += n;
     }
-
-    str[index] = '\0';
-}
-
-// removes newline from string
-void choppy( char *s ) {
-    s[strcspn(s, "\n")] = '\0';
-}
-
-// packs Message as 0/*sizeOfPacket*//*[drive/turn]*//*[distance/angle]*//*[percentSpeed/DefaultSpeed]*/1
-void packMessage(char *data, char *dist_angle, char *percentSpeed, char *str) {
-    choppy(data);
-    choppy(dist_angle);
-    choppy(percentSpeed);
-    int bodySize = strlen(data) + strlen(dist_angle) + strlen(percentSpeed);
-    char bodySize_s[20];
-    itoa(bodySize, bodySize_s);
-    memset(str, 0, strlen(str));
-    strcat(str, "0/*");
-    strcat(str, bodySize_s);
-    strcat(str, "*//*");
-    strcat(str, data);
-    strcat(str, "*//*");
-    strcat(str, dist_angle);
-    strcat(str, "*//*");
-    strcat(str, percentSpeed);
-    strcat(str, "*/1");
+    return true;
 }
 
 // main function to send messages to Maxwell board
 void setUpSocket(char *argv1, char *argv2) {
-    int sockfd, portno, n;
+    int sockfd, portno;
     struct sockaddr_in serv_addr;
     struct hostent *server;
 
@@ -154,48 +96,59 @@ void setUpSocket(char *argv1, char *argv2) {
         error("ERROR connecting");
     }
 
+    protocolFrame_t frame;
+    uint8_t packet[PROTOCOL_FRAME_SIZE];
+    uint32_t seq = 0;
     while (1) {
-        char data[10];
-        memset(data, 0, strlen(data));
-        char dist_angle[10];
-        memset(dist_angle, 0, strlen(dist_angle));
-        char percentSpeed[10];
-        memset(percentSpeed, 0, strlen(percentSpeed));;
+        frame.value = 0;
+        frame.speed = 0;
 
         if (sendMode) {
             memset(buffer, 0, strlen(buffer));
             cout << "input drive command: ";
             cin  >> buffer;
-            memcpy(data, buffer, strlen(buffer));
-            memset(buffer, 0, strlen(buffer));
-            cout << "input dist/degree command: ";
-            cin  >> buffer;
-            memcpy(dist_angle, buffer, strlen(buffer));
-            memset(buffer, 0, strlen(buffer));
-            cout << "input Speed percent command: ";
-            cin  >> buffer;
-            memcpy(percentSpeed, buffer, strlen(buffer));
-
+            frame.op = protocolOpFromName(buffer);
+            if (frame.op == PROTOCOL_OPS) {
+                cout << "drive, turn, stop or exit" << endl;
+                continue;
+            }
+            if (frame.op == PROTOCOL_DRIVE || frame.op == PROTOCOL_TURN) {
+                cout << "input dist/degree command: ";
+                cin  >> frame.value;
+                cout << "input Speed percent command: ";
+                cin  >> frame.speed;
+            }
         } else {
-            // fetch from threaded message buffer 
-            vector<string> message = bBuffer.fetch();
+            // next command from the statechart, closed when the vision loop ends
+            motorCommand_t command;
+            waitResult_t waited = takeCommand(&command, PROTOCOL_HEARTBEAT_MS);
+            if (waited == WAIT_CLOSED) {
+                break;
+            }
 
-            // create packet 
-            message[0].copy(data, message[0].size());
-            message[1].copy(dist_angle, message[1].size());
-            message[2].copy(percentSpeed, message[2].size());
+            // nothing to do for a while, tell Maxwell the link is still up
+            if (waited == WAIT_TIMEOUT) {
+                frame.op = PROTOCOL_HEARTBEAT;
+            } else {
+                frame.op = command.op;
+                frame.value = command.value;
+                frame.speed = command.speed;
+            }
         }
-        char packet[256];
-        memset(packet, 0, strlen(packet));
-        packMessage(data, dist_angle, percentSpeed, packet);
+        frame.seq = seq++;
+        frame.sentUs = protocolNowUs();
+        encodeFrame(&frame, packet);
 
         // send data packet
-        n = write(sockfd, packet, strlen(packet) + 1);
+        bool sent;
+        {
+            TRACE_SCOPE("socket write");
+            sent = writeFrame(sockfd, packet);
+        }
 
-        if (n < 0) {
+        if (!sent) {
             error("ERROR writing to socket");
         }
-
     }
     close(sockfd);
 }
@@ -212,16 +165,78 @@ int main(int argc, char *argv[]) {
             if (strcmp(argv[i], "-s") == 0) {
                 sendMode = true;
             }
+            if (strcmp(argv[i], "-t") == 0) {
+                trackMode = true;
+            }
+            // no preview window, for running on the robot without a display
+            if (strcmp(argv[i], "headless") == 0) {
+                headlessMode = true;
+            }
+            // pyramid detection on 1/2 (-p 1) or 1/4 (-p 2) scale
+            if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+                pyramidLevel = atoi(argv[i + 1]);
+                if (pyramidLevel < 0 || pyramidLevel > PYRAMID_MAX_LEVEL) {
+                    cout << "-p takes a pyramid level from 0 to " << PYRAMID_MAX_LEVEL << endl;
+                    return 1;
+                }
+            }
+            // segment with a colour lookup table built from the HSV bounds
+            if (strcmp(argv[i], "-l") == 0) {
+                lutMode = true;
+            }
+            // segment the camera's YUYV directly, frames from -v are never converted to BGR
+            if (strcmp(argv[i], "-y") == 0) {
+                yuvMode = true;
+            }
+            // resegment only the tiles that changed, and reuse the last detection when none did
+            if (strcmp(argv[i], "-u") == 0) {
+                changeMode = true;
+            }
+            // queue every command in order instead of sending only the latest, the vision loop waits on the sender
+            if (strcmp(argv[i], "-q") == 0) {
+                queueMode = true;
+            }
+            // V4L2 device (-v /dev/video0) or raw 640x480 YUYV recording to capture from
+            if (strcmp(argv[i], "-v") == 0 && i + 1 < argc) {
+                capturePath = argv[i + 1];
+            }
+            // Chrome trace of the vision stages, written when the video ends (-T trace.json)
+            if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+                tracePath = argv[i + 1];
+            }
+            // start from a stored calibration profile without prompts (-c lab), see calibrationProfile.h
+            if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+                profileName = argv[i + 1];
+            }
+            // profile file other than BB8-profiles.txt (-C profiles.txt)
+            if (strcmp(argv[i], "-C") == 0 && i + 1 < argc) {
+                profilePath = argv[i + 1];
+            }
         }
     }
+    // -u keeps its own full frame tile cache, so it cannot search windows or a coarse level
+    if (changeMode && (trackMode || pyramidLevel > 0)) {
+        cout << "-u cannot be combined with -t or -p" << endl;
+        return 1;
+    }
 
     // run message send thread
     thread t1(setUpSocket, argv[1], argv[2]);
 
     if (!sendMode) {
         analyzeVideo();
+        closeCommands();
+        if (tracePath != NULL) {
+            traceDump(tracePath);
+        }
     }
     t1.join();
 
+    if (!sendMode && !queueMode) {
+        mailboxStats_t stats = commandMailbox.stats();
+        printf("commands: %ld posted, %ld sent, %ld overwritten, %ld dropped\n", stats.posted, stats.sent,
+               stats.overwritten, stats.dropped);
+    }
+
     return 0;
 }
@@ -0,0 +1,63 @@
+#include <stdlib.h>
+#include <errno.h>
+#include "allocCount.h"
+
+#if defined(COUNT_ALLOCATIONS) && defined(__GLIBC__)
+// glibc's own allocator, which the wrappers below forward to
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+}
+
+// plain thread local data, so counting never allocates itself
+static __thread long allocations = 0;
+
+extern "C" void *malloc(size_t size) {
+	allocations++;
+	return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) {
+	allocations++;
+	return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) {
+	allocations++;
+	return __libc_realloc(ptr, size);
+}
+
+extern "C" void *memalign(size_t alignment, size_t size) {
+	allocations++;
+	return __libc_memalign(alignment, size);
+}
+
+extern "C" void *aligned_alloc(size_t alignment, size_t size) {
+	allocations++;
+	return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void **ptr, size_t alignment, size_t size) {
+	allocations++;
+	*ptr = __libc_memalign(alignment, size);
+	return *ptr == NULL ? ENOMEM : 0;
+}
+
+bool countingAllocations() {
+	return true;
+}
+
+long threadAllocations() {
+	return allocations;
+}
+#else
+bool countingAllocations() {
+	return false;
+}
+
+long threadAllocations() {
+	return 0;
+}
+#endif
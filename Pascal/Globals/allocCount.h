@@ -0,0 +1,15 @@
+#ifndef ALLOCCOUNT_H
+#define ALLOCCOUNT_H
+#include <stdio.h>
+#include <stdlib.h>
+
+// frames a stage may allocate in before it has to run allocation free
+#define ALLOC_WARMUP_FRAMES 30
+
+// Heap allocation counting for the vision loop. When built with
+// -DCOUNT_ALLOCATIONS=ON, malloc and its relatives are wrapped so every
+// allocation is counted for the thread that makes it, OpenCV's included.
+bool countingAllocations();
+// allocations made by the calling thread so far, 0 when not counting
+long threadAllocations();
+#endif
@@ -0,0 +1,19 @@
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "channel.h"
+
+static_assert(sizeof(atomic<int>) == sizeof(int), "futex needs a plain 32 bit word");
+
+void futexWait(atomic<int> *word, int expected, int timeoutMs) {
+    struct timespec timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = (long)(timeoutMs % 1000) * 1000000;
+    syscall(SYS_futex, (int *)word, FUTEX_WAIT_PRIVATE, expected, timeoutMs < 0 ? NULL : &timeout, NULL, 0);
+}
+
+void futexWake(atomic<int> *word) {
+    syscall(SYS_futex, (int *)word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
@@ -0,0 +1,153 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <utility>
+
+// polls before a side goes to sleep, a handoff is usually quicker than a futex round trip
+#define CHANNEL_SPINS 200
+
+using namespace std;
+
+// what a timed wait ended with
+typedef enum {
+    WAIT_READY = 0,
+    WAIT_TIMEOUT,
+    WAIT_CLOSED
+} waitResult_t;
+
+// Sleeps while *word is still expected, or until futexWake or timeoutMs (-1 for
+// none). Spurious returns are allowed, callers check their condition again.
+void futexWait(atomic<int> *word, int expected, int timeoutMs = -1);
+void futexWake(atomic<int> *word);
+
+// Single producer, single consumer ring of N slots, N a power of two. push and
+// pop are wait free while the ring is neither full nor empty: one slot move and
+// one index store. Only then does a side spin briefly and sleep on a futex,
+// and the other side only makes a syscall when it sees a sleeper. Once closed,
+// push fails and pop drains what is left and then fails.
+template <typename T, unsigned N>
+class Channel {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "Channel size must be a power of two");
+
+    T slots[N];
+    // free running, the slot is the index modulo N. Each on its own cache line
+    alignas(64) atomic<uint32_t> head;
+    alignas(64) atomic<uint32_t> tail;
+    // bumped to wake a sleeping consumer (items) or producer (space)
+    alignas(64) atomic<int> itemEvent;
+    atomic<int> consumerWaiting;
+    alignas(64) atomic<int> spaceEvent;
+    atomic<int> producerWaiting;
+    atomic<bool> closed;
+
+    static void wake(atomic<int> *event, atomic<int> *waiting) {
+        if (waiting->load()) {
+            event->fetch_add(1);
+            futexWake(event);
+        }
+    }
+
+    // Sleeps until ready() holds, the channel closes or the deadline passes. The
+    // waiting flag is set before ready() is checked again, and the other side
+    // stores its index before reading the flag, so one of them always sees the other.
+    template <typename Ready>
+    void waitFor(atomic<int> *event, atomic<int> *waiting, Ready ready,
+                 const chrono::steady_clock::time_point *deadline = NULL) {
+        for (int i = 0; i < CHANNEL_SPINS; i++) {
+            if (ready() || closed.load(memory_order_acquire)) {
+                return;
+            }
+        }
+        while (true) {
+            int timeoutMs = -1;
+            if (deadline != NULL) {
+                timeoutMs = (int)chrono::duration_cast<chrono::milliseconds>(*deadline - chrono::steady_clock::now()).count();
+                if (timeoutMs <= 0) {
+                    return;
+                }
+            }
+            int seen = event->load();
+            waiting->store(1);
+            if (ready() || closed.load()) {
+                waiting->store(0, memory_order_relaxed);
+                return;
+            }
+            futexWait(event, seen, timeoutMs);
+            waiting->store(0, memory_order_relaxed);
+        }
+    }
+
+    void take(uint32_t h, T *item) {
+        *item = std::move(slots[h & (N - 1)]);
+        head.store(h + 1);
+        wake(&spaceEvent, &producerWaiting);
+    }
+
+public:
+    Channel() : head(0), tail(0), itemEvent(0), consumerWaiting(0), spaceEvent(0), producerWaiting(0), closed(false) {
+    }
+
+    // moves item in, waiting while the ring is full
+    bool push(T &item) {
+        uint32_t t = tail.load(memory_order_relaxed);
+        if (t - head.load(memory_order_acquire) == N) {
+            waitFor(&spaceEvent, &producerWaiting, [this, t](){ return t - head.load() != N; });
+        }
+        if (closed.load(memory_order_acquire)) {
+            return false;
+        }
+
+        slots[t & (N - 1)] = std::move(item);
+        tail.store(t + 1);
+        wake(&itemEvent, &consumerWaiting);
+        return true;
+    }
+
+    bool push(T &&item) {
+        return push(item);
+    }
+
+    // moves the oldest item out, waiting while the ring is empty
+    bool pop(T *item) {
+        uint32_t h = head.load(memory_order_relaxed);
+        if (tail.load(memory_order_acquire) == h) {
+            waitFor(&itemEvent, &consumerWaiting, [this, h](){ return tail.load() != h; });
+            // closed and drained
+            if (tail.load(memory_order_acquire) == h) {
+                return false;
+            }
+        }
+
+        take(h, item);
+        return true;
+    }
+
+    // as pop, but gives up when the ring stays empty for timeoutMs
+    waitResult_t pop(T *item, int timeoutMs) {
+        uint32_t h = head.load(memory_order_relaxed);
+        if (tail.load(memory_order_acquire) == h) {
+            chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+            waitFor(&itemEvent, &consumerWaiting, [this, h](){ return tail.load() != h; }, &deadline);
+            if (tail.load(memory_order_acquire) == h) {
+                return closed.load(memory_order_acquire) ? WAIT_CLOSED : WAIT_TIMEOUT;
+            }
+        }
+
+        take(h, item);
+        return WAIT_READY;
+    }
+
+    void close() {
+        closed.store(true);
+        itemEvent.fetch_add(1);
+        futexWake(&itemEvent);
+        spaceEvent.fetch_add(1);
+        futexWake(&spaceEvent);
+    }
+};
+
+#endif
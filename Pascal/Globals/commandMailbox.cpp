@@ -0,0 +1,98 @@
+#include "commandMailbox.h"
+
+static bool isPriority(motorOp_t op) {
+    return op == MOTOR_STOP || op == MOTOR_EXIT;
+}
+
+CommandMailbox::CommandMailbox() : hasLatest(false), hasPriority(false), latestSeq(0), prioritySeq(0),
+                                   seq(0), closed(false) {
+    counts.posted = 0;
+    counts.sent = 0;
+    counts.overwritten = 0;
+    counts.dropped = 0;
+}
+
+void CommandMailbox::post(const motorCommand_t &command) {
+    {
+        lock_guard<mutex> l(lock);
+        counts.posted++;
+        if (closed) {
+            counts.dropped++;
+            return;
+        }
+
+        if (isPriority(command.op)) {
+            // exit outranks stop, a pending exit is kept
+            if (hasPriority && priority.op == MOTOR_EXIT && command.op == MOTOR_STOP) {
+                counts.dropped++;
+                return;
+            }
+            if (hasPriority) {
+                counts.overwritten++;
+            }
+            priority = command;
+            prioritySeq = ++seq;
+            hasPriority = true;
+        } else {
+            if (command.op == MOTOR_NONE && (hasLatest || hasPriority)) {
+                counts.dropped++;
+                return;
+            }
+            if (hasLatest) {
+                counts.overwritten++;
+            }
+            latest = command;
+            latestSeq = ++seq;
+            hasLatest = true;
+        }
+    }
+    not_empty.notify_one();
+}
+
+bool CommandMailbox::take(motorCommand_t *command) {
+    unique_lock<mutex> l(lock);
+    not_empty.wait(l, [this](){return hasLatest || hasPriority || closed; });
+    return takeLocked(command);
+}
+
+waitResult_t CommandMailbox::take(motorCommand_t *command, int timeoutMs) {
+    unique_lock<mutex> l(lock);
+    not_empty.wait_for(l, chrono::milliseconds(timeoutMs), [this](){return hasLatest || hasPriority || closed; });
+    if (takeLocked(command)) {
+        return WAIT_READY;
+    }
+    return closed ? WAIT_CLOSED : WAIT_TIMEOUT;
+}
+
+// the caller holds lock
+bool CommandMailbox::takeLocked(motorCommand_t *command) {
+    if (hasPriority) {
+        *command = priority;
+        hasPriority = false;
+        // a drive or turn decided before the stop must not follow it
+        if (hasLatest && latestSeq < prioritySeq) {
+            hasLatest = false;
+            counts.dropped++;
+        }
+    } else if (hasLatest) {
+        *command = latest;
+        hasLatest = false;
+    } else {
+        return false;
+    }
+    counts.sent++;
+    return true;
+}
+
+void CommandMailbox::close() {
+    {
+        lock_guard<mutex> l(lock);
+        closed = true;
+    }
+    not_empty.notify_all();
+}
+
+mailboxStats_t CommandMailbox::stats() {
+    lock_guard<mutex> l(lock);
+    return counts;
+}
@@ -0,0 +1,54 @@
+#ifndef COMMANDMAILBOX_H
+#define COMMANDMAILBOX_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "motorCommand.h"
+#include "channel.h"
+
+using namespace std;
+
+typedef struct {
+    long posted;
+    long sent;
+    long overwritten;   // replaced by a newer command before the sender took it
+    long dropped;       // never sent: stale behind a stop or exit, MOTOR_NONE or after close
+} mailboxStats_t;
+
+// Latest command wins between the statechart and the socket thread. post never
+// waits on the sender, a newer command replaces an unsent one. Stop and exit go
+// in their own slot, which the sender takes first and newer drives and turns
+// cannot replace, so neither is ever lost. A MOTOR_NONE only fills an empty
+// mailbox, it does not replace a command still to be sent.
+class CommandMailbox {
+    motorCommand_t latest;
+    motorCommand_t priority;
+    bool hasLatest;
+    bool hasPriority;
+    // post order of the two slots, a latest posted before the priority is stale once that is taken
+    uint64_t latestSeq;
+    uint64_t prioritySeq;
+    uint64_t seq;
+    bool closed;
+    mailboxStats_t counts;
+    // only held for the slot copies, never while sending
+    mutex lock;
+    condition_variable not_empty;
+
+    bool takeLocked(motorCommand_t *command);
+
+public:
+    CommandMailbox();
+    void post(const motorCommand_t &command);
+    // waits for a command, false once closed and empty
+    bool take(motorCommand_t *command);
+    // as take, but gives up after timeoutMs without a command
+    waitResult_t take(motorCommand_t *command, int timeoutMs);
+    void close();
+    mailboxStats_t stats();
+};
+
+#endif
@@ -3,6 +3,43 @@
 bool debugMode = false;
 bool sendMode = false;
 bool localhostMode = false;
+bool trackMode = false;
+bool headlessMode = false;
+int pyramidLevel = 0;
+bool lutMode = false;
+bool yuvMode = false;
+bool changeMode = false;
+bool queueMode = false;
+const char *capturePath = NULL;
+const char *tracePath = NULL;
+const char *profileName = NULL;
+
+Channel<motorCommand_t, COMMAND_CHANNEL_SIZE> commandChannel;
+CommandMailbox commandMailbox;
+
+void postCommand(const motorCommand_t &command) {
+    if (command.op == MOTOR_NONE) {
+        return;
+    }
+    if (queueMode) {
+        motorCommand_t copy = command;
+        commandChannel.push(copy);
+    } else {
+        commandMailbox.post(command);
+    }
+}
+
+waitResult_t takeCommand(motorCommand_t *command, int timeoutMs) {
+    if (queueMode) {
+        return commandChannel.pop(command, timeoutMs);
+    }
+    return commandMailbox.take(command, timeoutMs);
+}
+
+void closeCommands() {
+    commandChannel.close();
+    commandMailbox.close();
+}
 
 BoundedBuffer::BoundedBuffer(int capacity) : capacity(capacity), front(0), rear(0), count(0) {
     buffer.resize(capacity);
@@ -12,7 +49,7 @@ BoundedBuffer::~BoundedBuffer(){
 	buffer.clear();
 }
 
-void BoundedBuffer::deposit(vector<string> data){
+void BoundedBuffer::deposit(const motorCommand_t &data){
     unique_lock<mutex> l(lock);
     not_full.wait(l, [this](){return count != capacity; });
 
@@ -23,12 +60,12 @@ void BoundedBuffer::deposit(vector<string> data){
     not_empty.notify_one();
 }
 
-vector<string> BoundedBuffer::fetch(){
+motorCommand_t BoundedBuffer::fetch(){
     unique_lock<mutex> l(lock);
 
     not_empty.wait(l, [this](){return count != 0; });
 
-    vector<string> result = buffer[front];
+    motorCommand_t result = buffer[front];
     front = (front + 1) % capacity;
     --count;
 
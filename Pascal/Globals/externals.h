@@ -12,16 +12,31 @@
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
+#include "motorCommand.h"
+#include "channel.h"
+#include "commandMailbox.h"
 
 extern bool debugMode;
 extern bool sendMode;
 extern bool localhostMode;
+extern bool trackMode;
+extern bool headlessMode;
+extern int pyramidLevel;
+extern bool lutMode;
+extern bool yuvMode;
+extern bool changeMode;
+extern bool queueMode;
+extern const char *capturePath;
+extern const char *tracePath;
+extern const char *profileName;
 
 using namespace cv;
 using namespace std;
 
+// mutex and condition variable ring, the command path used to go through it and
+// Benchmark/channelBench.cpp still compares against it
 class BoundedBuffer {
-    vector<vector<string> > buffer;
+    vector<motorCommand_t> buffer;
     int capacity;
     int front;
     int rear;
@@ -33,10 +48,22 @@ class BoundedBuffer {
 public:
     BoundedBuffer(int capacity);
     ~BoundedBuffer();
-    void deposit(vector<string> data);
-    vector<string> fetch();
+    void deposit(const motorCommand_t &data);
+    motorCommand_t fetch();
 };
 
-extern BoundedBuffer bBuffer;
+// Commands from the statechart to the thread sending them to Maxwell. By
+// default only the latest is kept, see CommandMailbox, with queueMode every
+// command goes through commandChannel in order and the statechart waits when
+// it is full.
+#define COMMAND_CHANNEL_SIZE 2
+extern Channel<motorCommand_t, COMMAND_CHANNEL_SIZE> commandChannel;
+extern CommandMailbox commandMailbox;
+// MOTOR_NONE is not posted, Maxwell has nothing to do for it
+void postCommand(const motorCommand_t &command);
+// WAIT_TIMEOUT after timeoutMs without a command, WAIT_CLOSED once the vision
+// loop has ended and every command is taken
+waitResult_t takeCommand(motorCommand_t *command, int timeoutMs);
+void closeCommands();
 
 #endif
@@ -0,0 +1,30 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "motorCommand.h"
+
+// indexed by the direction bits, the impossible north and south together read as stationary
+static const char *directionNames[16] = {
+	"Stationary", "North", "South", "Stationary",
+	"East", "North-East", "South-East", "East",
+	"West", "North-West", "South-West", "West",
+	"Stationary", "North", "South", "Stationary"
+};
+
+static const char *opNames[] = {"", "drive", "turn", "stop", "exit"};
+
+motorCommand_t motorCommand(motorOp_t op, float value, float speed) {
+	motorCommand_t command;
+	command.op = op;
+	command.value = value;
+	command.speed = speed;
+	return command;
+}
+
+const char *directionName(direction_t direction) {
+	return directionNames[direction & 15];
+}
+
+const char *motorOpName(motorOp_t op) {
+	return opNames[op];
+}
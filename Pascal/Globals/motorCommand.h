@@ -0,0 +1,38 @@
+#ifndef MOTORCOMMAND_H
+#define MOTORCOMMAND_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+// Direction the object moves across the image, a bitmask so diagonals are two
+// bits, e.g. DIRECTION_NORTH | DIRECTION_WEST. 0 is standing still.
+typedef uint8_t direction_t;
+#define DIRECTION_STATIONARY 0
+#define DIRECTION_NORTH 1
+#define DIRECTION_SOUTH 2
+#define DIRECTION_EAST 4
+#define DIRECTION_WEST 8
+
+// what the statechart asks Maxwell to do, MOTOR_NONE while it is only watching
+typedef enum {
+	MOTOR_NONE = 0,
+	MOTOR_DRIVE,
+	MOTOR_TURN,
+	MOTOR_STOP,
+	MOTOR_EXIT
+} motorOp_t;
+
+// One statechart output. value is cm for a drive and degrees for a turn, speed
+// the fraction of full speed; stop and exit use neither.
+typedef struct {
+	motorOp_t op;
+	float value;
+	float speed;
+} motorCommand_t;
+
+motorCommand_t motorCommand(motorOp_t op, float value = 0, float speed = 0);
+// "North-West", "Stationary" and so on, for printing
+const char *directionName(direction_t direction);
+// "drive", "stop" and so on, "" for MOTOR_NONE
+const char *motorOpName(motorOp_t op);
+#endif
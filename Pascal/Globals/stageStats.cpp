@@ -0,0 +1,49 @@
+#include <iostream>
+#include "stageStats.h"
+#include "externals.h"
+
+StageStats::StageStats(const char *name) : name(name), frames(0), busyMs(0), totalFrames(0),
+                                           allocStart(0), frameAllocations(0), allocations(0) {
+    windowStart = chrono::steady_clock::now();
+}
+
+void StageStats::begin() {
+    allocStart = threadAllocations();
+    busyStart = chrono::steady_clock::now();
+}
+
+void StageStats::end() {
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    frameAllocations = threadAllocations() - allocStart;
+    busyMs += chrono::duration<double, milli>(now - busyStart).count();
+    frames++;
+    totalFrames++;
+
+    if (countingAllocations() && totalFrames > ALLOC_WARMUP_FRAMES) {
+        allocations += frameAllocations;
+        if (frameAllocations > 0) {
+            printf("%s stage: %ld heap allocations in frame %ld\n", name, frameAllocations, totalFrames);
+        }
+    }
+
+    if (frames == STAGE_REPORT_FRAMES) {
+        // a diagnostic like the rest of -f's output, it stays off the console otherwise
+        if (debugMode) {
+            double windowMs = chrono::duration<double, milli>(now - windowStart).count();
+            printf("%s stage: %.1f fps, %.2f ms/frame, %.0f%% busy", name,
+                   1000.0 * frames / windowMs, busyMs / frames, 100.0 * busyMs / windowMs);
+            if (countingAllocations()) {
+                printf(", %.1f allocs/frame", (double)allocations / frames);
+            }
+            printf("\n");
+        }
+        frames = 0;
+        busyMs = 0;
+        allocations = 0;
+        windowStart = now;
+    }
+}
+
+long StageStats::lastAllocations() {
+    return frameAllocations;
+}
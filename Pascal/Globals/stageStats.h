@@ -0,0 +1,36 @@
+#ifndef STAGESTATS_H
+#define STAGESTATS_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "allocCount.h"
+
+#define STAGE_REPORT_FRAMES 100
+
+using namespace std;
+
+// Throughput of one stage. begin() and end() bracket the work on a frame, the
+// time in between pushes and pops is waiting on the neighbouring stages.
+// With allocation counting on it also checks the stage stops allocating
+// once it is past ALLOC_WARMUP_FRAMES.
+class StageStats {
+    const char *name;
+    int frames;
+    double busyMs;
+    long totalFrames;
+    long allocStart;
+    long frameAllocations;
+    long allocations;
+    chrono::steady_clock::time_point windowStart;
+    chrono::steady_clock::time_point busyStart;
+
+public:
+    StageStats(const char *name);
+    void begin();
+    // with -f, prints fps, work per frame and utilisation every STAGE_REPORT_FRAMES frames
+    void end();
+    // heap allocations made by the last frame
+    long lastAllocations();
+};
+
+#endif
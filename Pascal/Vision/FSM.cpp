@@ -7,6 +7,7 @@
 #include <time.h>
 #include <unistd.h>
 #include "../Globals/externals.h"
+#include "../Globals/motorCommand.h"
 
 using namespace std;
 
@@ -73,7 +74,7 @@ float orient (float ogBBx, float ogBBy, float newBBx, float newBBy, float destx,
 }
 
 
-vector<string> MaxwellStatechart(float driveDistance, 
+motorCommand_t MaxwellStatechart(float driveDistance, 
 	bool offscreen, 
 	// bool start,
 	float bbx,
@@ -82,8 +83,8 @@ vector<string> MaxwellStatechart(float driveDistance,
 	float destx,
 	float desty,
 	float destR,
-	string direction) {
-	vector<string> output(3);
+	direction_t direction) {
+	motorCommand_t output = motorCommand(MOTOR_NONE);
 
 	// local state
 	static robotState_t robotState = MAXWELL_IDLE;
@@ -99,9 +100,7 @@ vector<string> MaxwellStatechart(float driveDistance,
 	static float dest_y_var;
 	static float dest_rad_var;
 	static float degreeToTurn;
-	static string speed = ".7";
-	static string degreeToTurnStr;
-	static string driveDistanceStr;
+	static float speed = 0.7;
 	static float driveDistancealmostStr;
 
 
@@ -110,7 +109,7 @@ vector<string> MaxwellStatechart(float driveDistance,
 		case MAXWELL_IDLE:
 			cout << "MAXWELL_IDLE (waiting state)" << endl;
 			cout << " " << endl;
-			if (direction == "Stationary") {
+			if (direction == DIRECTION_STATIONARY) {
 
 				if (bbx != 0 && bby != 0 && !isnan(bbx) && !isnan(bby)){
 					// cout << "IDLE NOT 0: " << bbx << " , " << bby << endl;
@@ -149,7 +148,7 @@ vector<string> MaxwellStatechart(float driveDistance,
 					cout << "MAXWELL_ORIENT_WAIT_1 (waiting state)" << endl;
 					cout << "BB Values: " << bbx << " , "<< bby <<endl;
 					cout << " " << endl;
-					if (direction == "Stationary") {
+					if (direction == DIRECTION_STATIONARY) {
 						subState = ORIENT_INITIAL_FORWARD;
 					}
 					break;
@@ -158,9 +157,7 @@ vector<string> MaxwellStatechart(float driveDistance,
 					cout << "ORIENT_INITIAL_FORWARD" << endl;
 					cout << "BB Values: " << bbx << " , "<< bby <<endl;
 					cout << " " << endl;
-					output[0] = "drive";
-					output[1] = "10";
-					output[2] = speed;
+					output = motorCommand(MOTOR_DRIVE, 10, speed);
 					
 					subState = ORIENT_WAIT;
 					break;
@@ -169,7 +166,7 @@ vector<string> MaxwellStatechart(float driveDistance,
 					cout << "ORIENT_WAIT (waiting state)" << endl;
 					cout << "BB Values: " << bbx << " , "<< bby <<endl;
 					cout << " " << endl;
-					if (direction == "Stationary") {
+					if (direction == DIRECTION_STATIONARY) {
 						subState = ORIENT_FINISHED;
 					}
 					if (offscreen){
@@ -196,7 +193,7 @@ vector<string> MaxwellStatechart(float driveDistance,
 		case MAXWELL_WAIT_1:
 			cout << "MAXWELL_WAIT_1 (waiting state)" << endl;
 			cout << " " << endl;
-			if (direction == "Stationary") {
+			if (direction == DIRECTION_STATIONARY) {
 				robotState = MAXWELL_TURN;
 			}
 			break;
@@ -205,19 +202,15 @@ vector<string> MaxwellStatechart(float driveDistance,
 			cout << "MAXWELL_TURN" << endl;
 			cout << degreeToTurn << endl;
 			cout << " " << endl;
-			degreeToTurnStr = to_string(degreeToTurn);
-			output[0] = "turn";
-			output[1] = degreeToTurnStr;
-			output[2] = speed;
+			output = motorCommand(MOTOR_TURN, degreeToTurn, speed);
 			robotState = MAXWELL_WAIT_2;
-			// cout << "degree turning in FSM: " << degreeToTurnStr << ", out0: " << output[0] << ", out1: " << output[1] << ", out2: " << output[2] << endl;
 			cout << " " << endl;
 			break;
 
 		case MAXWELL_WAIT_2:
 			cout << "MAXWELL_WAIT_2 (waiting state)" << endl;
 			cout << " " << endl;
-			if (direction == "Stationary") {
+			if (direction == DIRECTION_STATIONARY) {
 				robotState = MAXWELL_DRIVE;
 			}
 
@@ -229,7 +222,7 @@ vector<string> MaxwellStatechart(float driveDistance,
 					if ((newBBRad <= (destR/3) + 10) && (newBBRad >= (destR/3) - 10)){ //check that newRad is about the same as destR
 						robotState = MAXWELL_DONE;
 						// output.insert(0, "stop");
-						output[0] = "stop";
+						output = motorCommand(MOTOR_STOP);
 					}
 
 				// if ((bbx <= destx + 50) && (bbx >= destx - 50)){ //check that newRad is about the same as destR
@@ -240,7 +233,7 @@ vector<string> MaxwellStatechart(float driveDistance,
 				
 				// 		robotState = MAXWELL_DONE;
 				// 		// output.insert(0, "stop");
-				// 		output[0] = "stop";
+				// 		output = motorCommand(MOTOR_STOP);
 				// 	}
 				// }
 			}
@@ -261,10 +254,7 @@ vector<string> MaxwellStatechart(float driveDistance,
 				driveDistancealmostStr = 100;
 			}
 			// cout << "Dist to target (100): " << driveDistancealmostStr << endl;
-			driveDistanceStr = to_string(driveDistancealmostStr);
-			output[0] = "drive";
-			output[1] = driveDistanceStr;
-			output[2] = speed;
+			output = motorCommand(MOTOR_DRIVE, driveDistancealmostStr, speed);
 			
 			
 			if (driveDistance <= 15) {
@@ -275,7 +265,7 @@ vector<string> MaxwellStatechart(float driveDistance,
 				if ((newBBRad <= (destR/3) + 10) && (newBBRad >= (destR/3) - 10)){ //check that newRad is about the same as destR
 					robotState = MAXWELL_DONE;
 					// output.insert(0, "stop");
-					output[0] = "stop";
+					output = motorCommand(MOTOR_STOP);
 				}
 				robotState = MAXWELL_IDLE;
 				
@@ -291,7 +281,7 @@ vector<string> MaxwellStatechart(float driveDistance,
 		case MAXWELL_OFFSCREEN:
 			cout << "MAXWELL_OFFSCREEN" << endl;
 			cout << " " << endl;
-			output[0] = "stop";
+			output = motorCommand(MOTOR_STOP);
 			// robotState = MAXWELL_ORIENT;
 			// if (!offscreen) {
 			// 	robotState = MAXWELL_IDLE;
@@ -304,9 +294,7 @@ vector<string> MaxwellStatechart(float driveDistance,
 		case MAXWELL_TURN_180:
 			cout << "MAXWELL_TURN_180" << endl;
 			cout << " " << endl;
-			output[0] = "turn";
-			output[1] = "170";
-			output[2] = speed;
+			output = motorCommand(MOTOR_TURN, 170, speed);
 			// if (!offscreen) {
 				robotState = MAXWELL_OFFSCREEN_DRIVE;
 			// } else {
@@ -323,9 +311,7 @@ vector<string> MaxwellStatechart(float driveDistance,
 
 		case MAXWELL_OFFSCREEN_DRIVE:
 			cout << "MAXWELL_OFFSCREEN_DRIVE" << endl;
-			output[0] = "drive";
-			output[1] = "20";
-			output[2] = speed;
+			output = motorCommand(MOTOR_DRIVE, 20, speed);
 
 			robotState = MAXWELL_IDLE;
 		
@@ -335,7 +321,7 @@ vector<string> MaxwellStatechart(float driveDistance,
 			cout << "MAXWELL_DONE" << endl;
 			cout << " " << endl;
 			cout << "Dist to target: " << driveDistance << endl;
-			output[0] = "exit";
+			output = motorCommand(MOTOR_EXIT);
 			break;
 
 	}
@@ -5,11 +5,12 @@
 #include <stdlib.h>
 #include <iostream>
 #include <vector>
+#include "../Globals/motorCommand.h"
 
 using namespace std;
 
 float orient (float ogBBx, float ogBBy, float newBBx, float newBBy, float destx, float desty, int angle);
-vector<string> MaxwellStatechart(
+motorCommand_t MaxwellStatechart(
 	float driveDistance,
 	bool isOffscreen,
 	float bbx,
@@ -18,5 +19,5 @@ vector<string> MaxwellStatechart(
 	float destx,
 	float desty,
 	float destR,
-	string direction);
+	direction_t direction);
 #endif
\ No newline at end of file
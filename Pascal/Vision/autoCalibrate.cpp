@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <fstream>
+#include <opencv2/opencv.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "bitMask.h"
+#include "blob.h"
+#include "hsvThreshold.h"
+#include "segment.h"
+#include "autoCalibrate.h"
+
+using namespace cv;
+using namespace std;
+
+void clearHistogram(hsvHistogram_t *histogram) {
+	memset(histogram, 0, sizeof(hsvHistogram_t));
+}
+
+long sampleFrame(const Mat &bgr, Rect region, hsvHistogram_t *histogram, calibrateWorkspace_t *work) {
+	Rect frameRect(0, 0, bgr.cols, bgr.rows);
+	const BitMask *mask = NULL;
+
+	// the pipeline thresholds a blurred frame, so the bounds are learnt on one
+	Mat blurred = blurFrame(bgr, &work->blur);
+
+	if (region.area() == 0) {
+		// any hue, as long as it is clearly coloured
+		vector<hsvRange_t> coloured(1);
+		coloured[0].lowerBound = Scalar(0, CALIBRATE_MIN_SATURATION, CALIBRATE_MIN_VALUE);
+		coloured[0].upperBound = Scalar(179, 255, 255);
+		thresholdBGR(blurred, coloured, &work->masks);
+		cleanMask(&work->masks[0], &work->temp);
+		extractBlobs(work->masks[0], Point(0, 0), &work->blobs, &work->blobWork);
+
+		int largest = largestBlob(work->blobs);
+		if (largest < 0 || work->blobs[largest].area < CALIBRATE_MIN_AREA) {
+			return 0;
+		}
+		region = work->blobs[largest].box;
+		mask = &work->masks[0];
+	}
+	region &= frameRect;
+	if (region.area() == 0) {
+		return 0;
+	}
+
+	cvtColor(blurred(region), work->hsv, COLOR_BGR2HSV);
+
+	long added = 0;
+	for (int y = 0; y < region.height; y++) {
+		const uchar *p = work->hsv.ptr<uchar>(y);
+		for (int x = 0; x < region.width; x++, p += 3) {
+			// only the blob's own pixels, not the background in the corners of its box
+			if (mask != NULL && !mask->get(region.y + y, region.x + x)) {
+				continue;
+			}
+			histogram->h[p[0] < 180 ? p[0] : 179]++;
+			histogram->s[p[1]]++;
+			histogram->v[p[2]]++;
+			added++;
+		}
+	}
+	histogram->total += added;
+	return added;
+}
+
+// tightest [low, high] holding keep counts, trimming the same share off both tails
+static void linearBounds(const long *counts, int size, double percentile, int *low, int *high) {
+	long total = 0;
+	for (int i = 0; i < size; i++) {
+		total += counts[i];
+	}
+
+	long tail = (long)(total * (100 - percentile) / 200);
+	long sum = 0;
+	*low = 0;
+	while (*low < size - 1 && sum + counts[*low] <= tail) {
+		sum += counts[(*low)++];
+	}
+
+	sum = 0;
+	*high = size - 1;
+	while (*high > *low && sum + counts[*high] <= tail) {
+		sum += counts[(*high)--];
+	}
+}
+
+// shortest arc of hues holding the percentile, found with a window sliding round the wheel
+static void hueBounds(const long *counts, double percentile, int *low, int *high) {
+	long total = 0;
+	for (int i = 0; i < 180; i++) {
+		total += counts[i];
+	}
+
+	long keep = (long)ceil(total * percentile / 100);
+	int bestStart = 0;
+	int bestLength = 180;
+	int length = 0;
+	long sum = 0;
+
+	// window [start, start + length) is grown until it holds enough, then its start moves on
+	for (int start = 0; start < 180; start++) {
+		while (sum < keep && length < 180) {
+			sum += counts[(start + length) % 180];
+			length++;
+		}
+		if (sum >= keep && length < bestLength) {
+			bestLength = length;
+			bestStart = start;
+		}
+		sum -= counts[start];
+		length--;
+	}
+
+	*low = bestStart;
+	*high = (bestStart + max(bestLength, 1) - 1) % 180;
+}
+
+void histogramBounds(const hsvHistogram_t &histogram, double percentile, hsvRange_t *range) {
+	int hLow, hHigh, sLow, sHigh, vLow, vHigh;
+
+	hueBounds(histogram.h, percentile, &hLow, &hHigh);
+	linearBounds(histogram.s, 256, percentile, &sLow, &sHigh);
+	linearBounds(histogram.v, 256, percentile, &vLow, &vHigh);
+
+	range->lowerBound = Scalar(hLow, sLow, vLow);
+	range->upperBound = Scalar(hHigh, sHigh, vHigh);
+}
+
+bool saveHSV(const char *fileName, const hsvRange_t &range) {
+	ofstream file(fileName);
+	if (!file) {
+		return false;
+	}
+	file << (int)range.lowerBound[0] << endl;
+	file << (int)range.upperBound[0] << endl;
+	file << (int)range.lowerBound[1] << endl;
+	file << (int)range.upperBound[1] << endl;
+	file << (int)range.lowerBound[2] << endl;
+	file << (int)range.upperBound[2] << endl;
+	return file.good();
+}
@@ -0,0 +1,52 @@
+#ifndef AUTOCALIBRATE_H
+#define AUTOCALIBRATE_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "bitMask.h"
+#include "blob.h"
+#include "hsvThreshold.h"
+#include "segment.h"
+
+using namespace cv;
+using namespace std;
+
+#define CALIBRATE_FRAMES 15
+// share of the sampled pixels the bounds must cover, per channel
+#define CALIBRATE_PERCENTILE 95
+// what counts as strongly coloured when no region is given
+#define CALIBRATE_MIN_SATURATION 90
+#define CALIBRATE_MIN_VALUE 60
+// blobs smaller than this are not taken as the target
+#define CALIBRATE_MIN_AREA 200
+
+// H/S/V counts of every pixel sampled so far, in OpenCV's 8 bit scale
+typedef struct {
+	long h[180];
+	long s[256];
+	long v[256];
+	long total;
+} hsvHistogram_t;
+
+// scratch space kept between frames
+typedef struct {
+	blurWorkspace_t blur;
+	Mat hsv;
+	vector<BitMask> masks;
+	BitMask temp;
+	vector<blob_t> blobs;
+	blobWorkspace_t blobWork;
+} calibrateWorkspace_t;
+
+void clearHistogram(hsvHistogram_t *histogram);
+// Adds the pixels of region to the histogram, blurred the way segmentation
+// blurs them. An empty region samples the largest strongly coloured blob
+// instead. Returns the number of pixels added.
+long sampleFrame(const Mat &bgr, Rect region, hsvHistogram_t *histogram, calibrateWorkspace_t *work);
+// Tightest bounds holding percentile % of each channel. Hue takes the shortest
+// arc around the colour wheel, so red can come out as e.g. 172 to 6.
+void histogramBounds(const hsvHistogram_t &histogram, double percentile, hsvRange_t *range);
+// writes the six lines calibrate() writes and loadHSV() reads
+bool saveHSV(const char *fileName, const hsvRange_t &range);
+#endif
@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "bitMask.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+// 0xff for every set bit of an 8 bit group, one byte per pixel
+static uint64_t expandTable[256];
+
+static bool initExpandTable() {
+	for (int bits = 0; bits < 256; bits++) {
+		uint64_t bytes = 0;
+		for (int i = 0; i < 8; i++) {
+			if (bits & (1 << i)) {
+				bytes |= (uint64_t)0xff << (8 * i);
+			}
+		}
+		expandTable[bits] = bytes;
+	}
+	return true;
+}
+
+static const bool expandTableReady = initExpandTable();
+
+BitMask::BitMask() : rows(0), cols(0), wordsPerRow(0) {
+}
+
+void BitMask::create(int rows, int cols) {
+	this->rows = rows;
+	this->cols = cols;
+	wordsPerRow = (cols + 63) / 64;
+	// keeps its capacity, so reusing a mask of the same size never allocates
+	words.resize(rows * wordsPerRow);
+}
+
+void BitMask::clear() {
+	memset(words.data(), 0, words.size() * sizeof(uint64_t));
+}
+
+bool BitMask::get(int y, int x) const {
+	return (row(y)[x >> 6] >> (x & 63)) & 1;
+}
+
+uint64_t BitMask::lastWordMask() const {
+	return (cols & 63) ? ((uint64_t)1 << (cols & 63)) - 1 : ~(uint64_t)0;
+}
+
+void packMask(const Mat &mask, BitMask *bits) {
+	CV_Assert(mask.type() == CV_8UC1);
+	bits->create(mask.rows, mask.cols);
+
+	for (int y = 0; y < mask.rows; y++) {
+		const uchar *src = mask.ptr<uchar>(y);
+		uint64_t *dst = bits->row(y);
+		memset(dst, 0, bits->wordsPerRow * sizeof(uint64_t));
+
+		int x = 0;
+#if defined(__SSE2__)
+		const __m128i zero = _mm_setzero_si128();
+		for (; x + 16 <= mask.cols; x += 16) {
+			__m128i v = _mm_loadu_si128((const __m128i *)(src + x));
+			uint64_t group = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) & 0xffff;
+			dst[x >> 6] |= group << (x & 63);
+		}
+#endif
+		for (; x < mask.cols; x++) {
+			if (src[x]) {
+				dst[x >> 6] |= (uint64_t)1 << (x & 63);
+			}
+		}
+	}
+}
+
+void unpackRow(const uint64_t *src, int cols, uchar *dst) {
+	int x = 0;
+	for (; x + 8 <= cols; x += 8) {
+		memcpy(dst + x, &expandTable[(src[x >> 6] >> (x & 63)) & 0xff], 8);
+	}
+	for (; x < cols; x++) {
+		dst[x] = ((src[x >> 6] >> (x & 63)) & 1) ? 255 : 0;
+	}
+}
+
+void unpackMask(const BitMask &bits, Mat *mask) {
+	mask->create(bits.rows, bits.cols, CV_8UC1);
+	for (int y = 0; y < bits.rows; y++) {
+		unpackRow(bits.row(y), bits.cols, mask->ptr<uchar>(y));
+	}
+}
+
+// word i of the 5 pixel wide horizontal AND (erode) or OR (dilate) of a row.
+// Pixels past either end of the row read as `outside`.
+static inline uint64_t spread5(const uint64_t *row, int i, int n, uint64_t padding, uint64_t outside, bool isErode) {
+	uint64_t w = row[i] | (i == n - 1 ? padding : 0);
+	uint64_t prev = i > 0 ? row[i - 1] : outside;
+	uint64_t next = i < n - 1 ? row[i + 1] | (i + 1 == n - 1 ? padding : 0) : outside;
+
+	uint64_t left1 = (w << 1) | (prev >> 63);
+	uint64_t left2 = (w << 2) | (prev >> 62);
+	uint64_t right1 = (w >> 1) | (next << 63);
+	uint64_t right2 = (w >> 2) | (next << 62);
+
+	if (isErode) {
+		return w & left1 & left2 & right1 & right2;
+	}
+	return w | left1 | left2 | right1 | right2;
+}
+
+// The 5x5 ellipse is a single pixel on rows -2 and +2 and 5 pixels wide on
+// rows -1 to +1, so each output word combines three spread rows and two plain
+// rows. Rows outside the mask are left out, which matches OpenCV's default
+// border of "never erodes" and "never dilates".
+static void morph5x5(const BitMask &src, BitMask *dst, bool isErode) {
+	int n = src.wordsPerRow;
+	uint64_t lastMask = src.lastWordMask();
+	// erode treats the padding and the area past the row ends as set
+	uint64_t padding = isErode ? ~lastMask : 0;
+	uint64_t outside = isErode ? ~(uint64_t)0 : 0;
+
+	dst->create(src.rows, src.cols);
+
+	for (int y = 0; y < src.rows; y++) {
+		uint64_t *out = dst->row(y);
+		for (int i = 0; i < n; i++) {
+			uint64_t result = spread5(src.row(y), i, n, padding, outside, isErode);
+			for (int dy = -2; dy <= 2; dy++) {
+				int yy = y + dy;
+				if (dy == 0 || yy < 0 || yy >= src.rows) {
+					continue;
+				}
+				uint64_t term = (dy == -2 || dy == 2) ? src.row(yy)[i] | (i == n - 1 ? padding : 0)
+													  : spread5(src.row(yy), i, n, padding, outside, isErode);
+				result = isErode ? result & term : result | term;
+			}
+			out[i] = i == n - 1 ? result & lastMask : result;
+		}
+	}
+}
+
+void erodeMask(const BitMask &src, BitMask *dst) {
+	morph5x5(src, dst, true);
+}
+
+void dilateMask(const BitMask &src, BitMask *dst) {
+	morph5x5(src, dst, false);
+}
+
+// removes small objects from the foreground
+void openMask(BitMask *mask, BitMask *temp) {
+	erodeMask(*mask, temp);
+	dilateMask(*temp, mask);
+}
+
+// removes small holes from the foreground
+void closeMask(BitMask *mask, BitMask *temp) {
+	dilateMask(*mask, temp);
+	erodeMask(*temp, mask);
+}
@@ -0,0 +1,42 @@
+#ifndef BITMASK_H
+#define BITMASK_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+using namespace cv;
+using namespace std;
+
+// Binary mask with one bit per pixel. Pixel x of a row is bit (x % 64) of word
+// x / 64, every row starts on a new word and the padding bits stay 0.
+class BitMask {
+public:
+	int rows;
+	int cols;
+	int wordsPerRow;
+	vector<uint64_t> words;
+
+	BitMask();
+	void create(int rows, int cols);
+	void clear();
+	bool get(int y, int x) const;
+	uint64_t lastWordMask() const;
+	uint64_t *row(int y) { return &words[y * wordsPerRow]; }
+	const uint64_t *row(int y) const { return &words[y * wordsPerRow]; }
+};
+
+// conversions to and from 0/255 byte masks, e.g. for findContours
+void packMask(const Mat &mask, BitMask *bits);
+void unpackMask(const BitMask &bits, Mat *mask);
+void unpackRow(const uint64_t *src, int cols, uchar *dst);
+
+// 5x5 ellipse erode and dilate with OpenCV's default border handling
+void erodeMask(const BitMask &src, BitMask *dst);
+void dilateMask(const BitMask &src, BitMask *dst);
+
+// opening and closing in place, temp is scratch space of any size
+void openMask(BitMask *mask, BitMask *temp);
+void closeMask(BitMask *mask, BitMask *temp);
+#endif
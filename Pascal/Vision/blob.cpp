@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "bitMask.h"
+#include "blob.h"
+#include "../../Shared/trace.h"
+
+using namespace cv;
+using namespace std;
+
+// root of a run's component, halving the path on the way up
+static inline int findRoot(vector<int> &parent, int i) {
+	while (parent[i] != i) {
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+// the older run stays the root, so a component's root is its first run
+static inline void joinRuns(vector<int> &parent, int a, int b) {
+	a = findRoot(parent, a);
+	b = findRoot(parent, b);
+	if (a < b) {
+		parent[b] = a;
+	} else if (b < a) {
+		parent[a] = b;
+	}
+}
+
+// appends the runs of set bits in one packed row, a word at a time
+static void findRuns(const uint64_t *row, int wordsPerRow, int cols, int y, vector<run_t> *runs) {
+	int x = 0;
+
+	while (x < cols) {
+		// next set bit at or after x, the padding bits are always clear
+		int i = x >> 6;
+		uint64_t w = row[i] & (~(uint64_t)0 << (x & 63));
+		while (w == 0) {
+			if (++i == wordsPerRow) {
+				return;
+			}
+			w = row[i];
+		}
+		run_t run;
+		run.y = y;
+		run.start = (i << 6) + __builtin_ctzll(w);
+
+		// next clear bit after the start, or the end of the row
+		i = run.start >> 6;
+		w = ~row[i] & (~(uint64_t)0 << (run.start & 63));
+		while (w == 0 && ++i < wordsPerRow) {
+			w = ~row[i];
+		}
+		run.end = i < wordsPerRow ? min((i << 6) + __builtin_ctzll(w), cols) : cols;
+
+		runs->push_back(run);
+		x = run.end;
+	}
+}
+
+// sum of k^2 for k = 0..n-1
+static inline double sumSquares(double n) {
+	return (n - 1) * n * (2 * n - 1) / 6;
+}
+
+void extractBlobs(const BitMask &mask, Point offset, vector<blob_t> *blobs, blobWorkspace_t *work) {
+	TRACE_SCOPE("blobs");
+	vector<run_t> &runs = work->runs;
+	vector<int> &parent = work->parent;
+	int prevStart = 0;
+	int prevEnd = 0;
+
+	runs.clear();
+	parent.clear();
+	blobs->clear();
+
+	// label the runs, joining each to the runs it touches in the row above
+	for (int y = 0; y < mask.rows; y++) {
+		int rowStart = runs.size();
+		findRuns(mask.row(y), mask.wordsPerRow, mask.cols, y, &runs);
+		int rowEnd = runs.size();
+
+		int j = prevStart;
+		for (int r = rowStart; r < rowEnd; r++) {
+			parent.push_back(r);
+			// 8-connected, so runs that only meet at a corner still touch
+			while (j < prevEnd && runs[j].end < runs[r].start) {
+				j++;
+			}
+			for (int k = j; k < prevEnd && runs[k].start <= runs[r].end; k++) {
+				joinRuns(parent, k, r);
+			}
+		}
+		prevStart = rowStart;
+		prevEnd = rowEnd;
+	}
+
+	// sum the moments of every run into its component
+	int numRuns = runs.size();
+	work->blobIndex.assign(numRuns, -1);
+	work->sums.clear();
+	for (int r = 0; r < numRuns; r++) {
+		int root = findRoot(parent, r);
+		if (work->blobIndex[root] < 0) {
+			blobSums_t empty = {0, 0, 0, 0, 0, 0, runs[r].start, runs[r].y, runs[r].end - 1, runs[r].y};
+			work->blobIndex[root] = work->sums.size();
+			work->sums.push_back(empty);
+		}
+		blobSums_t &sums = work->sums[work->blobIndex[root]];
+
+		const run_t &run = runs[r];
+		double n = run.end - run.start;
+		double y = run.y;
+		double sumX = n * (run.start + run.end - 1) / 2;
+		sums.m00 += n;
+		sums.m10 += sumX;
+		sums.m01 += n * y;
+		sums.m20 += sumSquares(run.end) - sumSquares(run.start);
+		sums.m02 += n * y * y;
+		sums.m11 += y * sumX;
+		sums.minX = min(sums.minX, run.start);
+		sums.maxX = max(sums.maxX, run.end - 1);
+		sums.maxY = run.y;
+	}
+
+	for (int i = 0; i < work->sums.size(); i++) {
+		const blobSums_t &sums = work->sums[i];
+		double cx = sums.m10 / sums.m00;
+		double cy = sums.m01 / sums.m00;
+		blob_t blob;
+
+		blob.area = (int)sums.m00;
+		blob.centroid = Point2f(cx + offset.x, cy + offset.y);
+		blob.box = Rect(sums.minX + offset.x, sums.minY + offset.y, sums.maxX - sums.minX + 1, sums.maxY - sums.minY + 1);
+		blob.mu20 = sums.m20 - cx * sums.m10;
+		blob.mu02 = sums.m02 - cy * sums.m01;
+		blob.mu11 = sums.m11 - cx * sums.m01;
+		blob.radius = sqrt(max(2 * (blob.mu20 + blob.mu02) / sums.m00, 0.0));
+		blobs->push_back(blob);
+	}
+}
+
+int largestBlob(const vector<blob_t> &blobs) {
+	int index = -1;
+
+	for (int i = 0; i < blobs.size(); i++) {
+		if (index < 0 || blobs[i].area > blobs[index].area) {
+			index = i;
+		}
+	}
+	return index;
+}
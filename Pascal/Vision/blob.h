@@ -0,0 +1,53 @@
+#ifndef BLOB_H
+#define BLOB_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "bitMask.h"
+
+using namespace cv;
+using namespace std;
+
+// One 8-connected component of a mask. Coordinates are in the frame, i.e.
+// with the offset passed to extractBlobs added.
+typedef struct {
+	int area;
+	Point2f centroid;
+	Rect box;
+	// central second moments
+	double mu20;
+	double mu02;
+	double mu11;
+	// radius of the disc with the same second moments, sqrt(2 (mu20 + mu02) / area)
+	float radius;
+} blob_t;
+
+// horizontal run of set pixels, start to end - 1 of row y
+typedef struct {
+	int y;
+	int start;
+	int end;
+} run_t;
+
+// running sums of one component while the runs are merged
+typedef struct {
+	double m00, m10, m01, m20, m02, m11;
+	int minX, minY, maxX, maxY;
+} blobSums_t;
+
+// scratch space of extractBlobs, kept between frames so it does not reallocate
+typedef struct {
+	vector<run_t> runs;
+	vector<int> parent;
+	vector<int> blobIndex;
+	vector<blobSums_t> sums;
+} blobWorkspace_t;
+
+// Finds every component of the mask in one sweep over its runs, without
+// changing the mask. Centre and radius come from the moments.
+void extractBlobs(const BitMask &mask, Point offset, vector<blob_t> *blobs, blobWorkspace_t *work);
+// index of the largest blob, -1 if there are none
+int largestBlob(const vector<blob_t> &blobs);
+#endif
@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include "hsvThreshold.h"
+#include "calibrationProfile.h"
+
+using namespace cv;
+using namespace std;
+
+const char *profilePath = PROFILE_FILE;
+
+void defaultProfile(calibrationProfile_t *profile, const string &name) {
+	profile->name = name;
+	profile->camera = PROFILE_ANY_CAMERA;
+	profile->width = 640;
+	profile->height = 480;
+	profile->exposure = PROFILE_AUTO_EXPOSURE;
+	profile->object.lowerBound = Scalar(0, 0, 0);
+	profile->object.upperBound = Scalar(120, 255, 255);
+	profile->destination.lowerBound = Scalar(0, 0, 0);
+	profile->destination.upperBound = Scalar(120, 255, 255);
+}
+
+// six numbers in the order of the HSV files
+static bool readRange(istringstream &line, hsvRange_t *range) {
+	int v[6];
+	for (int i = 0; i < 6; i++) {
+		if (!(line >> v[i])) {
+			return false;
+		}
+	}
+	range->lowerBound = Scalar(v[0], v[2], v[4]);
+	range->upperBound = Scalar(v[1], v[3], v[5]);
+	return true;
+}
+
+static void writeRange(ofstream &file, const hsvRange_t &range) {
+	file << (int)range.lowerBound[0] << " " << (int)range.upperBound[0] << " "
+		<< (int)range.lowerBound[1] << " " << (int)range.upperBound[1] << " "
+		<< (int)range.lowerBound[2] << " " << (int)range.upperBound[2];
+}
+
+bool loadProfiles(const char *fileName, vector<calibrationProfile_t> *profiles) {
+	ifstream file(fileName);
+	profiles->clear();
+	if (!file) {
+		return false;
+	}
+
+	string text;
+	int lineNumber = 0;
+	bool versioned = false;
+	while (getline(file, text)) {
+		lineNumber++;
+		istringstream line(text);
+		string key;
+		// blank lines and # comments
+		if (!(line >> key) || key[0] == '#') {
+			continue;
+		}
+
+		bool ok = true;
+		if (key == "version") {
+			int version = 0;
+			line >> version;
+			if (version != PROFILE_VERSION) {
+				cout << fileName << ": version " << version << " profiles, expected " << PROFILE_VERSION << endl;
+				return false;
+			}
+			versioned = true;
+		} else if (!versioned) {
+			cout << fileName << ": no version line before line " << lineNumber << endl;
+			return false;
+		} else if (key == "profile") {
+			calibrationProfile_t profile;
+			string name;
+			ok = (bool)(line >> name);
+			defaultProfile(&profile, name);
+			profiles->push_back(profile);
+		} else if (profiles->empty()) {
+			ok = false;
+		} else if (key == "camera") {
+			ok = (bool)(line >> profiles->back().camera);
+		} else if (key == "resolution") {
+			ok = (bool)(line >> profiles->back().width >> profiles->back().height);
+		} else if (key == "exposure") {
+			ok = (bool)(line >> profiles->back().exposure);
+		} else if (key == "object") {
+			ok = readRange(line, &profiles->back().object);
+		} else if (key == "destination") {
+			ok = readRange(line, &profiles->back().destination);
+		} else {
+			// keys from a newer build of the same version are skipped
+			cout << fileName << ":" << lineNumber << ": unknown key " << key << endl;
+		}
+
+		if (!ok) {
+			cout << fileName << ":" << lineNumber << ": bad line '" << text << "'" << endl;
+			return false;
+		}
+	}
+	return versioned;
+}
+
+bool saveProfiles(const char *fileName, const vector<calibrationProfile_t> &profiles) {
+	string temp = string(fileName) + ".tmp";
+	ofstream file(temp.c_str());
+	if (!file) {
+		return false;
+	}
+
+	file << "# BB8 calibration profiles, HSV bounds are lowH highH lowS highS lowV highV" << endl;
+	file << "version " << PROFILE_VERSION << endl;
+	for (size_t i = 0; i < profiles.size(); i++) {
+		const calibrationProfile_t &profile = profiles[i];
+		file << endl << "profile " << profile.name << endl;
+		file << "camera " << profile.camera << endl;
+		file << "resolution " << profile.width << " " << profile.height << endl;
+		file << "exposure " << profile.exposure << endl;
+		file << "object ";
+		writeRange(file, profile.object);
+		file << endl << "destination ";
+		writeRange(file, profile.destination);
+		file << endl;
+	}
+	file.close();
+	if (file.fail()) {
+		remove(temp.c_str());
+		return false;
+	}
+	return rename(temp.c_str(), fileName) == 0;
+}
+
+bool findProfile(const char *fileName, const string &name, calibrationProfile_t *profile) {
+	vector<calibrationProfile_t> profiles;
+	if (!loadProfiles(fileName, &profiles)) {
+		cout << "Error loading profiles from " << fileName << endl;
+		return false;
+	}
+	for (size_t i = 0; i < profiles.size(); i++) {
+		if (profiles[i].name == name) {
+			*profile = profiles[i];
+			return true;
+		}
+	}
+	cout << "No profile " << name << " in " << fileName << endl;
+	return false;
+}
+
+void storeProfile(vector<calibrationProfile_t> *profiles, const calibrationProfile_t &profile) {
+	for (size_t i = 0; i < profiles->size(); i++) {
+		if ((*profiles)[i].name == profile.name) {
+			(*profiles)[i] = profile;
+			return;
+		}
+	}
+	profiles->push_back(profile);
+}
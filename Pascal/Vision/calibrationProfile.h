@@ -0,0 +1,52 @@
+#ifndef CALIBRATIONPROFILE_H
+#define CALIBRATIONPROFILE_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "hsvThreshold.h"
+
+using namespace cv;
+using namespace std;
+
+// file every profile lives in, next to Object-HSV.txt and Destination-HSV.txt
+#define PROFILE_FILE "BB8-profiles.txt"
+// bumped whenever a key changes meaning, older files are refused rather than misread
+#define PROFILE_VERSION 1
+// camera index that tries camera 1 then 0, as the prompts always did
+#define PROFILE_ANY_CAMERA -1
+// exposure that leaves the camera on auto exposure
+#define PROFILE_AUTO_EXPOSURE -1
+
+// Everything startup used to ask the operator for. The file holds a version
+// line and then one block per profile:
+//   profile lab
+//   camera 1
+//   resolution 640 480
+//   exposure -1
+//   object 0 10 120 255 80 255
+//   destination 100 130 90 255 40 255
+// with the HSV bounds in the order of the HSV files, lowH highH lowS highS lowV highV.
+typedef struct {
+	string name;
+	int camera;
+	int width;
+	int height;
+	int exposure;
+	hsvRange_t object;
+	hsvRange_t destination;
+} calibrationProfile_t;
+
+// file the profiles are read from and stored to, PROFILE_FILE unless given with -C
+extern const char *profilePath;
+
+// 640x480 on any camera with auto exposure, and bounds that take any hue like the prompts' defaults
+void defaultProfile(calibrationProfile_t *profile, const string &name);
+bool loadProfiles(const char *fileName, vector<calibrationProfile_t> *profiles);
+// written to a temporary file and renamed over fileName, so a reboot mid-write keeps the old profiles
+bool saveProfiles(const char *fileName, const vector<calibrationProfile_t> &profiles);
+bool findProfile(const char *fileName, const string &name, calibrationProfile_t *profile);
+// replaces the profile of the same name or appends it
+void storeProfile(vector<calibrationProfile_t> *profiles, const calibrationProfile_t &profile);
+#endif
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "changeDetect.h"
+#include "../../Shared/trace.h"
+
+using namespace cv;
+using namespace std;
+
+ChangeDetector::ChangeDetector() : tileCols(0), tileRows(0), numChanged(0) {
+}
+
+void ChangeDetector::reset() {
+	frameSize = Size();
+}
+
+// luma of every CHANGE_SAMPLE-th pixel, row major
+void ChangeDetector::sample(const Mat &frame) {
+	int cols = (frame.cols + CHANGE_SAMPLE - 1) / CHANGE_SAMPLE;
+	int rows = (frame.rows + CHANGE_SAMPLE - 1) / CHANGE_SAMPLE;
+	current.resize(cols * rows);
+
+	for (int y = 0; y < rows; y++) {
+		const uchar *src = frame.ptr<uchar>(y * CHANGE_SAMPLE);
+		uint8_t *dst = &current[y * cols];
+		if (frame.type() == CV_8UC2) {
+			// Y is every other byte of YUYV
+			for (int x = 0; x < cols; x++) {
+				dst[x] = src[2 * CHANGE_SAMPLE * x];
+			}
+		} else {
+			// BT.601 weights in 8 bit fixed point
+			for (int x = 0; x < cols; x++) {
+				const uchar *p = src + 3 * CHANGE_SAMPLE * x;
+				dst[x] = (29 * p[0] + 150 * p[1] + 77 * p[2]) >> 8;
+			}
+		}
+	}
+}
+
+int ChangeDetector::update(const Mat &frame) {
+	TRACE_SCOPE("change detect");
+	int cols = (frame.cols + CHANGE_SAMPLE - 1) / CHANGE_SAMPLE;
+	int tileSamplesX = CHANGE_TILE_WIDTH / CHANGE_SAMPLE;
+	int tileSamplesY = CHANGE_TILE_HEIGHT / CHANGE_SAMPLE;
+
+	sample(frame);
+
+	if (frame.size() != frameSize) {
+		frameSize = frame.size();
+		tileCols = (frame.cols + CHANGE_TILE_WIDTH - 1) / CHANGE_TILE_WIDTH;
+		tileRows = (frame.rows + CHANGE_TILE_HEIGHT - 1) / CHANGE_TILE_HEIGHT;
+		changed.assign(tileCols * tileRows, true);
+		numChanged = tileCols * tileRows;
+		return numChanged;
+	}
+
+	numChanged = 0;
+	for (int ty = 0; ty < tileRows; ty++) {
+		for (int tx = 0; tx < tileCols; tx++) {
+			int x0 = tx * tileSamplesX;
+			int x1 = min(x0 + tileSamplesX, cols);
+			int y0 = ty * tileSamplesY;
+			int y1 = min(y0 + tileSamplesY, (int)current.size() / cols);
+
+			int sad = 0;
+			int peak = 0;
+			for (int y = y0; y < y1; y++) {
+				const uint8_t *a = &current[y * cols];
+				const uint8_t *b = &reference[y * cols];
+				for (int x = x0; x < x1; x++) {
+					int d = abs(a[x] - b[x]);
+					sad += d;
+					peak = max(peak, d);
+				}
+			}
+
+			bool tileChanged = sad > CHANGE_THRESHOLD * (x1 - x0) * (y1 - y0) || peak > CHANGE_SAMPLE_THRESHOLD;
+			changed[ty * tileCols + tx] = tileChanged;
+			numChanged += tileChanged;
+		}
+	}
+	return numChanged;
+}
+
+void ChangeDetector::changedRuns(vector<Rect> *runs) const {
+	Rect frameRect(0, 0, frameSize.width, frameSize.height);
+	runs->clear();
+
+	for (int ty = 0; ty < tileRows; ty++) {
+		for (int tx = 0; tx < tileCols; tx++) {
+			if (!changed[ty * tileCols + tx]) {
+				continue;
+			}
+			int start = tx;
+			while (tx + 1 < tileCols && changed[ty * tileCols + tx + 1]) {
+				tx++;
+			}
+			Rect run(start * CHANGE_TILE_WIDTH, ty * CHANGE_TILE_HEIGHT,
+					 (tx - start + 1) * CHANGE_TILE_WIDTH, CHANGE_TILE_HEIGHT);
+			runs->push_back(run & frameRect);
+		}
+	}
+}
+
+void ChangeDetector::accept() {
+	int cols = (frameSize.width + CHANGE_SAMPLE - 1) / CHANGE_SAMPLE;
+	int tileSamplesX = CHANGE_TILE_WIDTH / CHANGE_SAMPLE;
+	int tileSamplesY = CHANGE_TILE_HEIGHT / CHANGE_SAMPLE;
+
+	if (reference.size() != current.size()) {
+		reference = current;
+		return;
+	}
+	for (int ty = 0; ty < tileRows; ty++) {
+		for (int tx = 0; tx < tileCols; tx++) {
+			if (!changed[ty * tileCols + tx]) {
+				continue;
+			}
+			int x0 = tx * tileSamplesX;
+			int x1 = min(x0 + tileSamplesX, cols);
+			int y1 = min((ty + 1) * tileSamplesY, (int)current.size() / cols);
+			for (int y = ty * tileSamplesY; y < y1; y++) {
+				copy(current.begin() + y * cols + x0, current.begin() + y * cols + x1, reference.begin() + y * cols + x0);
+			}
+		}
+	}
+}
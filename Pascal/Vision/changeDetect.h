@@ -0,0 +1,48 @@
+#ifndef CHANGEDETECT_H
+#define CHANGEDETECT_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+using namespace cv;
+using namespace std;
+
+// a tile is one word of a BitMask row wide, so cached masks copy word by word
+#define CHANGE_TILE_WIDTH 64
+#define CHANGE_TILE_HEIGHT 48
+// luma is compared on a grid of every 4th pixel each way
+#define CHANGE_SAMPLE 4
+// mean absolute luma difference of a tile's samples that counts as a change
+#define CHANGE_THRESHOLD 6
+// so does any one sample moving this far, e.g. the edge of a ball crossing a corner of the tile
+#define CHANGE_SAMPLE_THRESHOLD 40
+
+// Per tile change detection on a downsampled luma grid. Each tile is compared
+// with its luma when it was last segmented, not with the previous frame, so a
+// slow drift adds up until the tile is segmented again.
+class ChangeDetector {
+	Size frameSize;
+	int tileCols;
+	int tileRows;
+	vector<uint8_t> reference;
+	vector<uint8_t> current;
+	vector<bool> changed;
+	int numChanged;
+
+	void sample(const Mat &frame);
+
+public:
+	ChangeDetector();
+	// every tile counts as changed on the next frame
+	void reset();
+	// Samples a BGR or YUYV frame and compares each tile with its reference,
+	// returns how many tiles changed. A frame of a new size changes them all.
+	int update(const Mat &frame);
+	// changed tiles merged into runs along each row of tiles, in frame coordinates
+	void changedRuns(vector<Rect> *runs) const;
+	// once the changed tiles are segmented, their current luma becomes their reference
+	void accept();
+};
+#endif
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "bitMask.h"
+#include "blob.h"
+#include "segment.h"
+#include "circleVerify.h"
+#include "../../Shared/trace.h"
+
+using namespace cv;
+using namespace std;
+
+// ratio of the smaller to the larger of two positive values
+static float closeness(double a, double b) {
+	if (a <= 0 || b <= 0) {
+		return 0;
+	}
+	return a < b ? a / b : b / a;
+}
+
+void scoreCircle(const blob_t &blob, circleScore_t *score) {
+	// axes of the ellipse with the same second moments
+	double half = (blob.mu20 + blob.mu02) / 2;
+	double spread = sqrt((blob.mu20 - blob.mu02) * (blob.mu20 - blob.mu02) / 4 + blob.mu11 * blob.mu11);
+	score->circularity = half + spread > 0 ? sqrt(max(half - spread, 0.0) / (half + spread)) : 0;
+
+	// a disc covers pi / 4 of its box, a square or a ring does not
+	score->fill = closeness(blob.area, CV_PI / 4 * blob.box.width * blob.box.height);
+
+	// a ring or a blob with stray pixels has its moment radius away from its box
+	score->consistency = closeness(blob.radius, (blob.box.width + blob.box.height) / 4.0);
+
+	score->score = score->circularity * score->fill * score->consistency;
+	score->hough = false;
+
+	// filled corners or a hole, the product alone leaves a square at 0.68, a hair under CIRCLE_ACCEPT
+	if (blob.radius >= CIRCLE_FILL_RADIUS && score->fill < CIRCLE_MIN_FILL) {
+		score->score = 0;
+	}
+}
+
+// unpacks rect of the mask into a view of the scratch, rect.x need not be word aligned
+static Mat unpackRect(const BitMask &mask, Rect rect, Mat *scratch) {
+	int firstWord = rect.x >> 6;
+	int skip = rect.x - (firstWord << 6);
+	Mat unpacked = scratchView(scratch, Size(rect.width + skip, rect.height), CV_8UC1);
+
+	for (int y = 0; y < rect.height; y++) {
+		unpackRow(mask.row(rect.y + y) + firstWord, rect.width + skip, unpacked.ptr<uchar>(y));
+	}
+	return unpacked(Rect(skip, 0, rect.width, rect.height));
+}
+
+bool verifyCircle(const blob_t &blob, circleScore_t *score, circleCheck_t *check) {
+	if (score->score >= CIRCLE_ACCEPT) {
+		return true;
+	}
+	if (score->score < CIRCLE_REJECT) {
+		return false;
+	}
+
+	// ambiguous, e.g. cut by the frame edge or partly hidden, so look at the pixels
+	TRACE_SCOPE("hough");
+	score->hough = true;
+	Rect roi(blob.box.x - check->offset.x - CIRCLE_ROI_MARGIN, blob.box.y - check->offset.y - CIRCLE_ROI_MARGIN,
+			 blob.box.width + 2 * CIRCLE_ROI_MARGIN, blob.box.height + 2 * CIRCLE_ROI_MARGIN);
+	roi &= Rect(0, 0, check->mask->cols, check->mask->rows);
+	if (roi.width <= 0 || roi.height <= 0) {
+		return false;
+	}
+
+	Mat mask = unpackRect(*check->mask, roi, &check->roiStore);
+	GaussianBlur(mask, mask, Size(9,9), 0, 0);
+	// a partly hidden ball keeps its radius, so only circles of about the blob's size count
+	HoughCircles(mask, check->circles, CV_HOUGH_GRADIENT, 2, 15, 200, 80,
+				 (int)(blob.radius / 2), (int)(blob.radius * 3 / 2) + 1);
+
+	Point2f roiOrigin(roi.x + check->offset.x, roi.y + check->offset.y);
+	float bias = max((float)CIRCLE_HOUGH_BIAS, blob.radius / 2);
+	for (int i = 0; i < check->circles.size(); i++) {
+		Point2f circleCenter = Point2f(check->circles[i][0], check->circles[i][1]) + roiOrigin;
+		if (fabs(circleCenter.x - blob.centroid.x) < bias && fabs(circleCenter.y - blob.centroid.y) < bias) {
+			return true;
+		}
+	}
+	return false;
+}
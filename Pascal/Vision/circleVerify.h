@@ -0,0 +1,52 @@
+#ifndef CIRCLEVERIFY_H
+#define CIRCLEVERIFY_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "bitMask.h"
+#include "blob.h"
+
+using namespace cv;
+using namespace std;
+
+// scores at or above CIRCLE_ACCEPT are circles, below CIRCLE_REJECT are not,
+// anything in between is settled by Hough on the blob's part of the mask
+#define CIRCLE_ACCEPT 0.7
+#define CIRCLE_REJECT 0.35
+// A square fills its box (ratio 1), a disc pi / 4 = 0.785 of it and a ring less.
+// fill is the blob's area against a disc's, so a square gets 0.785 and a ring
+// its area over the disc's. A blob under CIRCLE_MIN_FILL is no disc and scores 0.
+// Blobs with a moment radius under CIRCLE_FILL_RADIUS are too coarse for it, a
+// 4 px disc fills its box about as fully as a square does
+#define CIRCLE_MIN_FILL 0.85
+#define CIRCLE_FILL_RADIUS 6
+// pixels of mask around the blob's box given to Hough
+#define CIRCLE_ROI_MARGIN 8
+// how far a Hough circle's centre may be from the blob's, px. Half the radius
+// for larger blobs, the centroid of a cut off ball is away from its centre
+#define CIRCLE_HOUGH_BIAS 10
+
+// how much a blob looks like a filled disc, every part is 1 for a perfect one
+typedef struct {
+	float circularity;	// minor over major axis of the moments' ellipse
+	float fill;			// area against a disc filling the box
+	float consistency;	// moment radius against the box's radius
+	float score;		// product of the three, 0 when fill rules a disc out
+	bool hough;			// the score was ambiguous and Hough ran
+} circleScore_t;
+
+// what detectObject needs to check a target's shape, with its scratch space
+typedef struct {
+	const BitMask *mask;
+	Point offset;	// frame position of the mask's top left pixel
+	vector<circleScore_t> scores;	// of every blob, filled by detectObject
+	Mat roiStore;
+	vector<Vec3f> circles;
+} circleCheck_t;
+
+// score from the blob's moments and box alone, no pixels are touched
+void scoreCircle(const blob_t &blob, circleScore_t *score);
+// true if the scored blob is a circle, runs Hough inside the blob's box when the score is ambiguous
+bool verifyCircle(const blob_t &blob, circleScore_t *score, circleCheck_t *check);
+#endif
@@ -0,0 +1,180 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "bitMask.h"
+#include "hsvThreshold.h"
+#include "colorLut.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+ColorLut::ColorLut() : numTargets(0), yuv(false) {
+}
+
+void ColorLut::build(const vector<hsvRange_t> &ranges, bool yuv) {
+	int levels = 1 << LUT_BITS;
+	int half = 1 << (7 - LUT_BITS);
+	// a YUV bin is one Y0 U Y1 V pair of two equal pixels, every pixel is used otherwise
+	int step = yuv ? 2 : 1;
+	Mat bgr;
+	vector<BitMask> masks;
+
+	CV_Assert(ranges.size() <= HSV_MAX_TARGETS);
+
+	// every bin's centre colour as one image, row c0 * levels + c1 and column c2
+	Mat centres(levels * levels, levels * step, yuv ? CV_8UC2 : CV_8UC3);
+	for (int c0 = 0; c0 < levels; c0++) {
+		for (int c1 = 0; c1 < levels; c1++) {
+			uchar *p = centres.ptr<uchar>(c0 * levels + c1);
+			for (int c2 = 0; c2 < levels; c2++, p += yuv ? 4 : 3) {
+				if (yuv) {
+					p[0] = p[2] = (c0 << (8 - LUT_BITS)) + half;
+					p[1] = (c1 << (8 - LUT_BITS)) + half;
+					p[3] = (c2 << (8 - LUT_BITS)) + half;
+				} else {
+					p[0] = (c0 << (8 - LUT_BITS)) + half;
+					p[1] = (c1 << (8 - LUT_BITS)) + half;
+					p[2] = (c2 << (8 - LUT_BITS)) + half;
+				}
+			}
+		}
+	}
+	if (yuv) {
+		cvtColor(centres, bgr, COLOR_YUV2BGR_YUYV);
+	} else {
+		bgr = centres;
+	}
+	thresholdBGR(bgr, ranges, &masks);
+
+	this->yuv = yuv;
+	numTargets = ranges.size();
+	classes.assign(LUT_SIZE, 0);
+	for (int t = 0; t < numTargets; t++) {
+		for (int y = 0; y < centres.rows; y++) {
+			for (int c2 = 0; c2 < levels; c2++) {
+				if (masks[t].get(y, c2 * step)) {
+					classes[y * levels + c2] |= 1 << t;
+				}
+			}
+		}
+	}
+}
+
+// 64 class entries -> the word of the pixels that have the bit set
+static inline uint64_t packClass(const uint8_t *cls, uint8_t bit) {
+	uint64_t word = 0;
+#if defined(__SSE2__)
+	const __m128i mask = _mm_set1_epi8(bit);
+	for (int i = 0; i < 64; i += 16) {
+		__m128i c = _mm_and_si128(_mm_loadu_si128((const __m128i *)(cls + i)), mask);
+		word |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(c, mask)) << i;
+	}
+#else
+	for (int i = 0; i < 64; i++) {
+		word |= (uint64_t)((cls[i] & bit) != 0) << i;
+	}
+#endif
+	return word;
+}
+
+void ColorLut::threshold(const Mat &bgr, BitMask **masks, int firstTarget, int count) const {
+	const uint8_t *table = classes.data();
+	const int shift = 8 - LUT_BITS;
+	uint8_t cls[64];
+
+	CV_Assert(bgr.type() == CV_8UC3 && firstTarget + count <= numTargets);
+
+	for (int t = 0; t < count; t++) {
+		masks[t]->create(bgr.rows, bgr.cols);
+	}
+
+	for (int y = 0; y < bgr.rows; y++) {
+		const uchar *src = bgr.ptr<uchar>(y);
+		for (int x0 = 0; x0 < bgr.cols; x0 += 64) {
+			int n = min(64, bgr.cols - x0);
+			const uchar *p = src + 3 * x0;
+			for (int i = 0; i < n; i++, p += 3) {
+				cls[i] = table[((p[0] >> shift) << (2 * LUT_BITS)) | ((p[1] >> shift) << LUT_BITS) | (p[2] >> shift)];
+			}
+			// the row's padding bits stay 0
+			memset(cls + n, 0, 64 - n);
+
+			for (int t = 0; t < count; t++) {
+				masks[t]->row(y)[x0 >> 6] = packClass(cls, 1 << (firstTarget + t));
+			}
+		}
+	}
+}
+
+void ColorLut::thresholdYUYV(const Mat &yuyv, BitMask **masks, int firstTarget, int count) const {
+	const uint8_t *table = classes.data();
+	const int shift = 8 - LUT_BITS;
+	uint8_t cls[64];
+
+	CV_Assert(yuv && yuyv.type() == CV_8UC2 && yuyv.cols % 2 == 0 && firstTarget + count <= numTargets);
+
+	for (int t = 0; t < count; t++) {
+		masks[t]->create(yuyv.rows, yuyv.cols);
+	}
+
+	for (int y = 0; y < yuyv.rows; y++) {
+		const uchar *src = yuyv.ptr<uchar>(y);
+		for (int x0 = 0; x0 < yuyv.cols; x0 += 64) {
+			int n = min(64, yuyv.cols - x0);
+			const uchar *p = src + 2 * x0;
+			// both pixels of a pair share its U and V
+			for (int i = 0; i < n; i += 2, p += 4) {
+				int uv = ((p[1] >> shift) << LUT_BITS) | (p[3] >> shift);
+				cls[i] = table[((p[0] >> shift) << (2 * LUT_BITS)) | uv];
+				cls[i + 1] = table[((p[2] >> shift) << (2 * LUT_BITS)) | uv];
+			}
+			memset(cls + n, 0, 64 - n);
+
+			for (int t = 0; t < count; t++) {
+				masks[t]->row(y)[x0 >> 6] = packClass(cls, 1 << (firstTarget + t));
+			}
+		}
+	}
+}
+
+void setColorTargets(colorTargets_t *targets, const vector<hsvRange_t> &ranges, int engine) {
+	targets->ranges = ranges;
+	targets->engine = engine;
+	if (engine == SEGMENT_LUT || engine == SEGMENT_YUV) {
+		targets->lut.build(ranges, engine == SEGMENT_YUV);
+	}
+}
+
+void thresholdTargets(const Mat &image, const colorTargets_t &targets, vector<BitMask> *masks) {
+	int numTargets = targets.ranges.size();
+	BitMask *dst[HSV_MAX_TARGETS];
+	masks->resize(numTargets);
+	for (int t = 0; t < numTargets; t++) {
+		dst[t] = &(*masks)[t];
+	}
+
+	if (image.type() == CV_8UC2) {
+		targets.lut.thresholdYUYV(image, dst, 0, numTargets);
+	} else if (targets.engine == SEGMENT_LUT) {
+		targets.lut.threshold(image, dst, 0, numTargets);
+	} else {
+		thresholdBGR(image, targets.ranges, masks);
+	}
+}
+
+void thresholdTarget(const Mat &image, const colorTargets_t &targets, int t, BitMask *mask) {
+	if (image.type() == CV_8UC2) {
+		targets.lut.thresholdYUYV(image, &mask, t, 1);
+	} else if (targets.engine == SEGMENT_LUT) {
+		targets.lut.threshold(image, &mask, t, 1);
+	} else {
+		thresholdBGR(image, &targets.ranges[t], &mask, 1);
+	}
+}
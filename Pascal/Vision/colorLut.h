@@ -0,0 +1,64 @@
+#ifndef COLORLUT_H
+#define COLORLUT_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "bitMask.h"
+#include "hsvThreshold.h"
+
+using namespace cv;
+using namespace std;
+
+// bits kept of each BGR channel, the table has 2^(3 * LUT_BITS) entries
+#define LUT_BITS 6
+#define LUT_SIZE (1 << (3 * LUT_BITS))
+
+// how segmentation tests pixels against the targets
+#define SEGMENT_HSV 0	// exact HSV conversion and bounds per pixel
+#define SEGMENT_LUT 1	// one ColorLut lookup per pixel
+#define SEGMENT_YUV 2	// one ColorLut lookup per pixel of the camera's YUYV, no BGR or HSV conversion
+
+// Quantized BGR (or YUV) -> set of targets, bit t of an entry is set when the
+// colour lies in target t's HSV range. Built once from the ranges, after that a
+// pixel costs one lookup however many targets there are.
+class ColorLut {
+	vector<uint8_t> classes;
+	int numTargets;
+	bool yuv;
+
+public:
+	ColorLut();
+	// Classifies the centre colour of every bin with the exact HSV kernel. A YUV
+	// table converts the centres to BGR the way frameToBGR converts YUYV, so it
+	// holds the HSV bounds expressed in the camera's own colour space.
+	void build(const vector<hsvRange_t> &ranges, bool yuv = false);
+	bool empty() const { return numTargets == 0; }
+	bool isYUV() const { return yuv; }
+	int targets() const { return numTargets; }
+	// b, g, r or y, u, v
+	uint8_t classify(int c0, int c1, int c2) const {
+		return classes[((c0 >> (8 - LUT_BITS)) << (2 * LUT_BITS)) | ((c1 >> (8 - LUT_BITS)) << LUT_BITS) | (c2 >> (8 - LUT_BITS))];
+	}
+	// masks[i] gets target firstTarget + i, for count targets
+	void threshold(const Mat &bgr, BitMask **masks, int firstTarget, int count) const;
+	// same from a CV_8UC2 YUYV image starting on a whole Y0 U Y1 V pair, with a YUV table
+	void thresholdYUYV(const Mat &yuyv, BitMask **masks, int firstTarget, int count) const;
+};
+
+// the colour targets segmentation looks for, and the engine it uses
+typedef struct {
+	vector<hsvRange_t> ranges;
+	int engine;
+	ColorLut lut;
+} colorTargets_t;
+
+// builds the table when the engine needs one
+void setColorTargets(colorTargets_t *targets, const vector<hsvRange_t> &ranges, int engine);
+// One mask per target. A CV_8UC2 image is YUYV and needs the SEGMENT_YUV
+// engine, a BGR image under SEGMENT_YUV is thresholded exactly in HSV.
+void thresholdTargets(const Mat &image, const colorTargets_t &targets, vector<BitMask> *masks);
+// the mask of target t alone
+void thresholdTarget(const Mat &image, const colorTargets_t &targets, int t, BitMask *mask);
+#endif
@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "hsvThreshold.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define HSV_SIMD 1
+#define HSV_LANES 8
+typedef __m256i vint;
+#define v_set1 _mm256_set1_epi32
+#define v_add _mm256_add_epi32
+#define v_sub _mm256_sub_epi32
+#define v_mul _mm256_mullo_epi32
+#define v_max _mm256_max_epi32
+#define v_min _mm256_min_epi32
+#define v_and _mm256_and_si256
+#define v_or _mm256_or_si256
+#define v_andnot _mm256_andnot_si256
+#define v_eq _mm256_cmpeq_epi32
+#define v_gt _mm256_cmpgt_epi32
+#define v_srai _mm256_srai_epi32
+#define v_select(m, a, b) _mm256_blendv_epi8(b, a, m)
+#define v_bits(m) _mm256_movemask_ps(_mm256_castsi256_ps(m))
+#define v_widen(bytes, half) _mm256_cvtepu8_epi32(bytes)
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#define HSV_SIMD 1
+#define HSV_LANES 4
+typedef __m128i vint;
+#define v_set1 _mm_set1_epi32
+#define v_add _mm_add_epi32
+#define v_sub _mm_sub_epi32
+#define v_mul _mm_mullo_epi32
+#define v_max _mm_max_epi32
+#define v_min _mm_min_epi32
+#define v_and _mm_and_si128
+#define v_or _mm_or_si128
+#define v_andnot _mm_andnot_si128
+#define v_eq _mm_cmpeq_epi32
+#define v_gt _mm_cmpgt_epi32
+#define v_srai _mm_srai_epi32
+#define v_select(m, a, b) _mm_blendv_epi8(b, a, m)
+#define v_bits(m) _mm_movemask_ps(_mm_castsi128_ps(m))
+#define v_widen(bytes, half) _mm_cvtepu8_epi32((half) ? _mm_srli_si128(bytes, 4) : (bytes))
+#else
+#define HSV_SIMD 0
+#endif
+
+using namespace cv;
+using namespace std;
+
+// OpenCV's RGB2HSV_b fixed point division tables, so the masks match cvtColor + inRange exactly
+#define HSV_SHIFT 12
+static int sdivTable[256];
+static int hdivTable[256];
+
+// integer form of an hsvRange_t
+typedef struct {
+	int hLow;
+	int hHigh;
+	int sLow;
+	int sHigh;
+	int vLow;
+	int vHigh;
+	bool wrap;
+} hsvBounds_t;
+
+static bool initTables() {
+	sdivTable[0] = hdivTable[0] = 0;
+	for (int i = 1; i < 256; i++) {
+		sdivTable[i] = cvRound((255 << HSV_SHIFT) / (1. * i));
+		hdivTable[i] = cvRound((180 << HSV_SHIFT) / (6. * i));
+	}
+	return true;
+}
+
+static const bool tablesReady = initTables();
+
+static int clampBound(double value) {
+	int bound = cvRound(value);
+	return bound < 0 ? 0 : (bound > 255 ? 255 : bound);
+}
+
+static void getBounds(const hsvRange_t &range, hsvBounds_t *bounds) {
+	bounds->hLow = clampBound(range.lowerBound[0]);
+	bounds->hHigh = clampBound(range.upperBound[0]);
+	bounds->sLow = clampBound(range.lowerBound[1]);
+	bounds->sHigh = clampBound(range.upperBound[1]);
+	bounds->vLow = clampBound(range.lowerBound[2]);
+	bounds->vHigh = clampBound(range.upperBound[2]);
+	bounds->wrap = bounds->hLow > bounds->hHigh;
+}
+
+// same arithmetic as OpenCV's RGB2HSV_b with a hue range of 180
+static inline void getHSV(int b, int g, int r, int *h, int *s, int *v) {
+	int vmax = max(b, max(g, r));
+	int diff = vmax - min(b, min(g, r));
+	int hue;
+
+	if (vmax == r) {
+		hue = g - b;
+	} else if (vmax == g) {
+		hue = b - r + 2 * diff;
+	} else {
+		hue = r - g + 4 * diff;
+	}
+
+	hue = (hue * hdivTable[diff] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT;
+	*h = hue < 0 ? hue + 180 : hue;
+	*s = (diff * sdivTable[vmax] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT;
+	*v = vmax;
+}
+
+static inline bool inBounds(int h, int s, int v, const hsvBounds_t &bounds) {
+	if (v < bounds.vLow || v > bounds.vHigh || s < bounds.sLow || s > bounds.sHigh) {
+		return false;
+	}
+	return bounds.wrap ? (h >= bounds.hLow || h <= bounds.hHigh) : (h >= bounds.hLow && h <= bounds.hHigh);
+}
+
+#if HSV_SIMD
+// splits 8 packed BGR pixels (24 bytes) into the low 8 bytes of b, g and r
+static inline void loadBGR8(const uchar *src, __m128i *b, __m128i *g, __m128i *r) {
+	__m128i lo = _mm_loadl_epi64((const __m128i *)src);
+	__m128i hi = _mm_loadu_si128((const __m128i *)(src + 8));
+	const char z = -1;
+
+	*b = _mm_or_si128(_mm_shuffle_epi8(lo, _mm_setr_epi8(0, 3, 6, z, z, z, z, z, z, z, z, z, z, z, z, z)),
+					  _mm_shuffle_epi8(hi, _mm_setr_epi8(z, z, z, 1, 4, 7, 10, 13, z, z, z, z, z, z, z, z)));
+	*g = _mm_or_si128(_mm_shuffle_epi8(lo, _mm_setr_epi8(1, 4, 7, z, z, z, z, z, z, z, z, z, z, z, z, z)),
+					  _mm_shuffle_epi8(hi, _mm_setr_epi8(z, z, z, 2, 5, 8, 11, 14, z, z, z, z, z, z, z, z)));
+	*r = _mm_or_si128(_mm_shuffle_epi8(lo, _mm_setr_epi8(2, 5, z, z, z, z, z, z, z, z, z, z, z, z, z, z)),
+					  _mm_shuffle_epi8(hi, _mm_setr_epi8(z, z, 0, 3, 6, 9, 12, 15, z, z, z, z, z, z, z, z)));
+}
+
+// table[idx] for every lane
+static inline vint gather(const int *table, vint idx) {
+#if defined(__AVX2__)
+	return _mm256_i32gather_epi32(table, idx, 4);
+#else
+	return _mm_setr_epi32(table[_mm_extract_epi32(idx, 0)], table[_mm_extract_epi32(idx, 1)],
+						  table[_mm_extract_epi32(idx, 2)], table[_mm_extract_epi32(idx, 3)]);
+#endif
+}
+#endif
+
+// thresholds one row of BGR pixels into one packed bit row per range
+static void thresholdRow(const uchar *src, int cols, const hsvBounds_t *bounds, int numTargets,
+						 uint64_t **dst, int wordsPerRow) {
+	for (int t = 0; t < numTargets; t++) {
+		memset(dst[t], 0, wordsPerRow * sizeof(uint64_t));
+	}
+
+	int x = 0;
+#if HSV_SIMD
+	const vint rounding = v_set1(1 << (HSV_SHIFT - 1));
+	const vint hueRange = v_set1(180);
+	const vint zero = v_set1(0);
+	const vint all = v_set1(-1);
+
+	for (; x + 8 <= cols; x += 8) {
+		__m128i b8, g8, r8;
+		loadBGR8(src + 3*x, &b8, &g8, &r8);
+
+		for (int half = 0; half < 8 / HSV_LANES; half++) {
+			vint b = v_widen(b8, half);
+			vint g = v_widen(g8, half);
+			vint r = v_widen(r8, half);
+
+			vint v = v_max(b, v_max(g, r));
+			vint diff = v_sub(v, v_min(b, v_min(g, r)));
+			vint diff2 = v_add(diff, diff);
+
+			vint hueR = v_sub(g, b);
+			vint hueG = v_add(v_sub(b, r), diff2);
+			vint hueB = v_add(v_sub(r, g), v_add(diff2, diff2));
+			vint h = v_select(v_eq(v, r), hueR, v_select(v_eq(v, g), hueG, hueB));
+			h = v_srai(v_add(v_mul(h, gather(hdivTable, diff)), rounding), HSV_SHIFT);
+			h = v_add(h, v_and(v_gt(zero, h), hueRange));
+			vint s = v_srai(v_add(v_mul(diff, gather(sdivTable, v)), rounding), HSV_SHIFT);
+
+			int shift = (x & 63) + half * HSV_LANES;
+			for (int t = 0; t < numTargets; t++) {
+				const hsvBounds_t &tb = bounds[t];
+				vint fail = v_or(v_gt(v_set1(tb.vLow), v), v_gt(v, v_set1(tb.vHigh)));
+				fail = v_or(fail, v_or(v_gt(v_set1(tb.sLow), s), v_gt(s, v_set1(tb.sHigh))));
+
+				vint belowLow = v_gt(v_set1(tb.hLow), h);
+				vint aboveHigh = v_gt(h, v_set1(tb.hHigh));
+				fail = v_or(fail, tb.wrap ? v_and(belowLow, aboveHigh) : v_or(belowLow, aboveHigh));
+
+				dst[t][x >> 6] |= (uint64_t)v_bits(v_andnot(fail, all)) << shift;
+			}
+		}
+	}
+#endif
+	// scalar fallback and the pixels left over at the end of the row
+	for (; x < cols; x++) {
+		int h, s, v;
+		getHSV(src[3*x], src[3*x + 1], src[3*x + 2], &h, &s, &v);
+		for (int t = 0; t < numTargets; t++) {
+			if (inBounds(h, s, v, bounds[t])) {
+				dst[t][x >> 6] |= (uint64_t)1 << (x & 63);
+			}
+		}
+	}
+}
+
+void thresholdBGR(const Mat &bgr, const vector<hsvRange_t> &ranges, vector<BitMask> *masks) {
+	int numTargets = ranges.size();
+	BitMask *dst[HSV_MAX_TARGETS];
+
+	CV_Assert(numTargets <= HSV_MAX_TARGETS);
+	masks->resize(numTargets);
+	for (int t = 0; t < numTargets; t++) {
+		dst[t] = &(*masks)[t];
+	}
+	thresholdBGR(bgr, ranges.data(), dst, numTargets);
+}
+
+void thresholdBGR(const Mat &bgr, const hsvRange_t *ranges, BitMask **masks, int numTargets) {
+	hsvBounds_t bounds[HSV_MAX_TARGETS];
+	uint64_t *dst[HSV_MAX_TARGETS];
+
+	CV_Assert(bgr.type() == CV_8UC3 && numTargets <= HSV_MAX_TARGETS);
+
+	for (int t = 0; t < numTargets; t++) {
+		getBounds(ranges[t], &bounds[t]);
+		masks[t]->create(bgr.rows, bgr.cols);
+	}
+
+	for (int y = 0; y < bgr.rows; y++) {
+		for (int t = 0; t < numTargets; t++) {
+			dst[t] = masks[t]->row(y);
+		}
+		thresholdRow(bgr.ptr<uchar>(y), bgr.cols, bounds, numTargets, dst, masks[0]->wordsPerRow);
+	}
+}
+
+void thresholdBGR(const Mat &bgr, const vector<hsvRange_t> &ranges, vector<Mat> *masks) {
+	int numTargets = ranges.size();
+	int wordsPerRow = (bgr.cols + 63) / 64;
+	hsvBounds_t bounds[HSV_MAX_TARGETS];
+	vector<uint64_t> rowBits(numTargets * wordsPerRow);
+	uint64_t *dst[HSV_MAX_TARGETS];
+
+	CV_Assert(bgr.type() == CV_8UC3 && numTargets <= HSV_MAX_TARGETS);
+
+	masks->resize(numTargets);
+	for (int t = 0; t < numTargets; t++) {
+		getBounds(ranges[t], &bounds[t]);
+		(*masks)[t].create(bgr.size(), CV_8UC1);
+		dst[t] = &rowBits[t * wordsPerRow];
+	}
+
+	for (int y = 0; y < bgr.rows; y++) {
+		thresholdRow(bgr.ptr<uchar>(y), bgr.cols, bounds, numTargets, dst, wordsPerRow);
+		for (int t = 0; t < numTargets; t++) {
+			unpackRow(dst[t], bgr.cols, (*masks)[t].ptr<uchar>(y));
+		}
+	}
+}
@@ -0,0 +1,28 @@
+#ifndef HSVTHRESHOLD_H
+#define HSVTHRESHOLD_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "bitMask.h"
+
+using namespace cv;
+using namespace std;
+
+#define HSV_MAX_TARGETS 8
+
+// HSV bounds of one colour target, in OpenCV's 8 bit scale (H 0-179, S and V 0-255)
+// a lower H above the upper H selects the range that wraps around 180, e.g. red at 170-10
+typedef struct {
+	Scalar lowerBound;
+	Scalar upperBound;
+} hsvRange_t;
+
+// Fused BGR -> HSV -> inRange. Writes one mask per range straight from the BGR
+// pixels without materialising an HSV image. Uses AVX2 or SSE4.1 when the build
+// enables them and a scalar loop otherwise; all paths give the same mask.
+void thresholdBGR(const Mat &bgr, const vector<hsvRange_t> &ranges, vector<BitMask> *masks);
+void thresholdBGR(const Mat &bgr, const hsvRange_t *ranges, BitMask **masks, int numTargets);
+// same, as 0/255 byte masks
+void thresholdBGR(const Mat &bgr, const vector<hsvRange_t> &ranges, vector<Mat> *masks);
+#endif
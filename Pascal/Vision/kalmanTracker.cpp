@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <opencv2/opencv.hpp>
+#include "kalmanTracker.h"
+
+using namespace cv;
+using namespace std;
+
+static void predictAxis(kalmanAxis_t *a, double dt, double accelNoise, bool still) {
+	double q = accelNoise * accelNoise;
+
+	if (still) {
+		// the command says it is not moving, whatever velocity was estimated
+		a->vel = 0;
+		a->pv = 0;
+		a->vv = 0;
+	}
+
+	a->pos += a->vel * dt;
+	a->pp += 2 * dt * a->pv + dt * dt * a->vv + q * dt * dt * dt * dt / 4;
+	a->pv += dt * a->vv + q * dt * dt * dt / 2;
+	a->vv += q * dt * dt;
+}
+
+static void correctAxis(kalmanAxis_t *a, double measured) {
+	double r = KALMAN_MEASURE_NOISE * KALMAN_MEASURE_NOISE;
+	double s = a->pp + r;
+	double kp = a->pp / s;
+	double kv = a->pv / s;
+	double innovation = measured - a->pos;
+
+	a->pos += kp * innovation;
+	a->vel += kv * innovation;
+	a->vv -= kv * a->pv;
+	a->pv *= 1 - kp;
+	a->pp *= 1 - kp;
+}
+
+static void initAxis(kalmanAxis_t *a, double measured) {
+	a->pos = measured;
+	a->vel = 0;
+	a->pp = KALMAN_MEASURE_NOISE * KALMAN_MEASURE_NOISE;
+	a->pv = 0;
+	a->vv = KALMAN_INITIAL_SPEED * KALMAN_INITIAL_SPEED;
+}
+
+KalmanTracker::KalmanTracker() : still(false), boostFrames(0), lastCommand(MOTOR_NONE) {
+	for (int i = 0; i < 3; i++) {
+		initAxis(&axes[i], 0);
+	}
+	reset();
+}
+
+// Forgets the track. The estimate stays where it was, without the old
+// velocity, until seed() starts over from the next detection.
+void KalmanTracker::reset() {
+	for (int i = 0; i < 3; i++) {
+		axes[i].vel = 0;
+	}
+	initialized = false;
+	boostFrames = 0;
+	misses = 0;
+	gated = 0;
+}
+
+void KalmanTracker::seed(Point2f center, float radius) {
+	initAxis(&axes[0], center.x);
+	initAxis(&axes[1], center.y);
+	initAxis(&axes[2], radius);
+	initialized = true;
+	misses = 0;
+	gated = 0;
+}
+
+void KalmanTracker::command(motorOp_t op) {
+	// the statechart outputs nothing while it is only watching
+	if (op == MOTOR_NONE || op == lastCommand) {
+		return;
+	}
+	lastCommand = op;
+	still = op != MOTOR_DRIVE;
+	if (!still) {
+		boostFrames = KALMAN_COMMAND_FRAMES;
+	}
+}
+
+void KalmanTracker::predict(double dt) {
+	if (!initialized || dt <= 0) {
+		return;
+	}
+
+	double boost = 1;
+	if (boostFrames > 0) {
+		boost = sqrt((double)KALMAN_COMMAND_BOOST);
+		boostFrames--;
+	}
+	predictAxis(&axes[0], dt, KALMAN_ACCEL_NOISE * boost, still);
+	predictAxis(&axes[1], dt, KALMAN_ACCEL_NOISE * boost, still);
+	predictAxis(&axes[2], dt, KALMAN_RADIUS_NOISE * boost, still);
+}
+
+double KalmanTracker::distance(Point2f center, float radius) const {
+	double measured[3] = {center.x, center.y, radius};
+	double d2 = 0;
+
+	for (int i = 0; i < 3; i++) {
+		double innovation = measured[i] - axes[i].pos;
+		d2 += innovation * innovation / (axes[i].pp + KALMAN_MEASURE_NOISE * KALMAN_MEASURE_NOISE);
+	}
+	return d2;
+}
+
+// before the first detection anything starts the track
+bool KalmanTracker::accepts(Point2f center, float radius) const {
+	return !initialized || distance(center, radius) < KALMAN_GATE;
+}
+
+// the first measurement after a reset seeds the track instead of correcting the stale one
+void KalmanTracker::correct(Point2f center, float radius) {
+	double measured[3] = {center.x, center.y, radius};
+
+	if (!initialized) {
+		seed(center, radius);
+		return;
+	}
+	for (int i = 0; i < 3; i++) {
+		correctAxis(&axes[i], measured[i]);
+	}
+	misses = 0;
+	gated = 0;
+}
+
+void KalmanTracker::countMiss() {
+	if (initialized && ++misses > KALMAN_MAX_MISSES) {
+		reset();
+	}
+}
+
+// a frame without any detection ends a run of rejected ones
+void KalmanTracker::miss() {
+	gated = 0;
+	countMiss();
+}
+
+bool KalmanTracker::reject(Point2f center, float radius) {
+	if (++gated >= KALMAN_MAX_GATED) {
+		seed(center, radius);
+		return true;
+	}
+	countMiss();
+	return false;
+}
+
+Vec3f KalmanTracker::deviation() const {
+	return Vec3f(sqrt(axes[0].pp), sqrt(axes[1].pp), sqrt(axes[2].pp));
+}
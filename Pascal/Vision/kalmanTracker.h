@@ -0,0 +1,84 @@
+#ifndef KALMANTRACKER_H
+#define KALMANTRACKER_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <opencv2/opencv.hpp>
+#include "../Globals/motorCommand.h"
+
+using namespace cv;
+using namespace std;
+
+// how hard the ball may speed up or slow down between frames, px/s^2
+#define KALMAN_ACCEL_NOISE 400
+#define KALMAN_RADIUS_NOISE 60
+// process noise factor for the frames right after Maxwell is told to drive
+#define KALMAN_COMMAND_BOOST 16
+#define KALMAN_COMMAND_FRAMES 10
+// spread of the blob centroid and moment radius, px
+#define KALMAN_MEASURE_NOISE 2
+// spread of the speed the first detection could have, px/s
+#define KALMAN_INITIAL_SPEED 200
+// chi-square 99% bound with 3 degrees of freedom
+#define KALMAN_GATE 11.34
+// misses after which the next detection starts a new track
+#define KALMAN_MAX_MISSES 30
+// round detections outside the gate in a row after which the ball is taken
+// to have jumped, e.g. been picked up, and the track restarts from it
+#define KALMAN_MAX_GATED 5
+
+// position and velocity along one axis with their covariance
+typedef struct {
+	double pos;
+	double vel;
+	double pp;
+	double pv;
+	double vv;
+} kalmanAxis_t;
+
+// Constant velocity Kalman filter for the object's centre and radius. The
+// axes are independent under this model, so it runs as three 2-state
+// filters. The last motor command is the control input: while Maxwell is
+// stopped or turning on the spot the ball is expected to hold still, and
+// right after a drive starts the filter lets the velocity change quickly.
+// Commands do carry a speed, but it is the statechart's fixed motor duty
+// with no feedback from the wheels, so it says nothing about how fast the
+// ball moves in the image and only the op is used.
+class KalmanTracker {
+	kalmanAxis_t axes[3];
+	bool initialized;
+	bool still;
+	int boostFrames;
+	int misses;
+	int gated;
+	motorOp_t lastCommand;
+
+	// starts a new track at a measurement, with no velocity and wide uncertainty
+	void seed(Point2f center, float radius);
+	void countMiss();
+
+public:
+	KalmanTracker();
+	// drops the track, the next measurement seeds a new one
+	void reset();
+	bool ready() const { return initialized; }
+	// the op of the statechart's last output
+	void command(motorOp_t op);
+	// moves the estimate dt seconds forward
+	void predict(double dt);
+	// squared Mahalanobis distance of a measurement from the prediction
+	double distance(Point2f center, float radius) const;
+	bool accepts(Point2f center, float radius) const;
+	void correct(Point2f center, float radius);
+	// no usable measurement this frame, keeps the prediction
+	void miss();
+	// a detection the gate turned away, counted as a miss until there have
+	// been KALMAN_MAX_GATED in a row. Returns true when it reseeded the track.
+	bool reject(Point2f center, float radius);
+	Point2f center() const { return Point2f(axes[0].pos, axes[1].pos); }
+	float radius() const { return axes[2].pos; }
+	// px/s
+	Point2f velocity() const { return Point2f(axes[0].vel, axes[1].vel); }
+	// standard deviation of the centre and radius estimates
+	Vec3f deviation() const;
+};
+#endif
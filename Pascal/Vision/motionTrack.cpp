@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <queue>
 #include <string>
 #include <fstream>
@@ -13,6 +14,8 @@
 #include "../Globals/externals.h"
 #include "motionTrack.h"
 #include "FSM.h"
+#include "calibrationProfile.h"
+#include "../../Shared/trace.h"
 
 using namespace cv;
 using namespace std;
@@ -56,21 +59,19 @@ void calibrate(VideoCapture cap, Scalar *lowerBound, Scalar *upperBound, ofstrea
              break;
         }
 
-	    Mat imgHSV, imgThresholded;
+	    vector<hsvRange_t> ranges(1);
+	    vector<BitMask> bits;
+	    BitMask temp;
+	    Mat imgThresholded;
 
-	    //Convert the captured frame from BGR to HSV
-	    cvtColor(imgOriginal, imgHSV, COLOR_BGR2HSV);
+	    //Threshold the image straight from BGR
+	    ranges[0].lowerBound = Scalar(iLowH, iLowS, iLowV);
+	    ranges[0].upperBound = Scalar(iHighH, iHighS, iHighV);
+	    thresholdBGR(imgOriginal, ranges, &bits);
 
-	    //Threshold the image
-	    inRange(imgHSV, Scalar(iLowH, iLowS, iLowV), Scalar(iHighH, iHighS, iHighV), imgThresholded);
-	      
-	    //morphological opening (removes small objects from the foreground)
-	    erode(imgThresholded, imgThresholded, getStructuringElement(MORPH_ELLIPSE, Size(5, 5)) );
-	    dilate( imgThresholded, imgThresholded, getStructuringElement(MORPH_ELLIPSE, Size(5, 5)) ); 
-
-	    //morphological closing (removes small holes from the foreground)
-	    dilate(imgThresholded, imgThresholded, getStructuringElement(MORPH_ELLIPSE, Size(5, 5)) ); 
-	    erode(imgThresholded, imgThresholded, getStructuringElement(MORPH_ELLIPSE, Size(5, 5)) );
+	    //morphological opening and closing on the bit packed mask
+	    cleanMask(&bits[0], &temp);
+	    unpackMask(bits[0], &imgThresholded);
 
 	    *lowerBound = Scalar(iLowH, iLowS, iLowV);
 	    *upperBound = Scalar(iHighH, iHighS, iHighV);
@@ -93,177 +94,175 @@ void calibrate(VideoCapture cap, Scalar *lowerBound, Scalar *upperBound, ofstrea
     }
 }
 
-void filterImage(Mat *frame, Mat *mask, Scalar lowerBound, Scalar upperBound,
-				 vector<Vec3f> circles, bool isObject) {
-	Mat gray, blur, hsv_frame;
-
-	// imshow("original frame", frame);
-	GaussianBlur(*frame, blur, Size(11,11), 0, 0);
-	cvtColor(blur, hsv_frame, CV_BGR2HSV);
-	// imshow("hsv image", hsv_frame);
+void filterImage(Mat *frame, Mat *mask, Scalar lowerBound, Scalar upperBound) {
+	vector<hsvRange_t> ranges(1);
+	colorTargets_t targets;
+	vector<BitMask> masks;
+	BitMask temp;
+	blurWorkspace_t blur;
 
-	// mask hsv_frame with upper and lower HSV bounds
-	inRange(hsv_frame, lowerBound, upperBound, *mask);
+	ranges[0].lowerBound = lowerBound;
+	ranges[0].upperBound = upperBound;
+	setColorTargets(&targets, ranges, SEGMENT_HSV);
 
-    // morphological opening (removes small objects from the foreground)
-    erode(*mask, *mask, getStructuringElement(MORPH_ELLIPSE, Size(5, 5)) );
-    dilate(*mask, *mask, getStructuringElement(MORPH_ELLIPSE, Size(5, 5)) ); 
+	// mask with upper and lower HSV bounds
+	segmentFrame(frame, targets, &masks, &blur);
 
-    // morphological closing (removes small holes from the foreground)
-    dilate(*mask, *mask, getStructuringElement(MORPH_ELLIPSE, Size(5, 5)) ); 
-    erode(*mask, *mask, getStructuringElement(MORPH_ELLIPSE, Size(5, 5)) );
+	filterMask(&masks[0], &temp, mask);
+}
 
-	// imshow("mask2", mask);
-    if (isObject) {
-		cvtColor(blur, gray, CV_BGR2GRAY);
-		// imshow("gray", gray);
-		GaussianBlur(*mask, *mask, Size(9,9), 0, 0);
-		// imshow("blur mask", mask);
-		// play around with HoughCircle parameters to get better circle detection
-		HoughCircles(*mask, circles, CV_HOUGH_GRADIENT, 2, 15, 200, 80, 0, 0);
-	}
+// cleans up a bit mask from segmentFrame and unpacks it into a byte mask,
+// circles are checked later on the blobs by verifyCircle
+void filterMask(BitMask *bits, BitMask *temp, Mat *mask) {
+	cleanMask(bits, temp);
+	unpackMask(*bits, mask);
 }
 
 // play around with radialBias to tune how big the object is to detect
-void detectObject(Mat *frame, vector<Vec3f> circles, vector<vector<Point> > contours, Point2f *center, Point2f prev_center,
-				  float *radius, float prev_radius, bool isObject, bool *isOffscreen, int bias, int radialBias) {
-	double largest_area = 0;
-	int contour_index = 0;
-	deque <vector<Point> > largest_contours;
-	int contours_size;
-
-	// if contours exist
-	if (contours.size() > 0) {
-		// find largest area and center
-		for (int i = 0; i < contours.size(); i++) {
-			double area = contourArea(contours[i], false);
-			if (area > largest_area) {
-				largest_area = area;
-				contour_index = i;
-				largest_contours.push_back(contours[i]);
-				contours_size = largest_contours.size();
-				if (contours_size > MAXSIZE){
-					largest_contours.pop_front();
+// with a tracker that has a track, the blob closest to its prediction is taken.
+// With a circle check, blobs that are clearly not round are never taken and the
+// one taken must pass as a circle to count as found.
+void detectObject(const vector<blob_t> &blobs, Point2f *center, Point2f prev_center,
+				  float *radius, float prev_radius, bool isObject, bool *isOffscreen, int *mark, int radialBias,
+				  const KalmanTracker *tracker, circleCheck_t *check) {
+	TRACE_SCOPE("detectObject");
+	int largest_area = 0;
+	*mark = MARK_NONE;
+	// indices of the last MAXSIZE blobs that were the largest so far, oldest first
+	int largest_blobs[MAXSIZE];
+	int blobs_size = 0;
+	int chosen = -1;
+
+	// shape scores from the moments, cheap enough for every blob
+	if (check != NULL) {
+		check->scores.resize(blobs.size());
+		for (int i = 0; i < blobs.size(); i++) {
+			scoreCircle(blobs[i], &check->scores[i]);
+		}
+	}
+
+	// if blobs exist
+	if (blobs.size() > 0) {
+		// find largest area
+		for (int i = 0; i < blobs.size(); i++) {
+			if (check != NULL && check->scores[i].score < CIRCLE_REJECT) {
+				continue;
+			}
+			if (blobs[i].area > largest_area) {
+				largest_area = blobs[i].area;
+				if (blobs_size == MAXSIZE) {
+					memmove(largest_blobs, largest_blobs + 1, (MAXSIZE - 1) * sizeof(int));
+					blobs_size--;
 				}
+				largest_blobs[blobs_size++] = i;
 			}
 		}
 
-		// vector<Point> correctContour = contours[contour_index];
-		float min_radius;
-		float max_radius;
-		float avg_radius;
-		float avg_center;
 		float dist_center;
 		float dist_radius;
-		Point2f min_center;
-		Point2f max_center;
 
-		for (int i = 0; i < largest_contours.size(); i++){
-			vector<Point> correctContour = largest_contours[i];
+		if (tracker != NULL && tracker->ready()) {
+			// the gate follows the filter's uncertainty instead of a fixed distance
+			double closest = -1;
+			for (int i = 0; i < blobs.size(); i++) {
+				if (check != NULL && check->scores[i].score < CIRCLE_REJECT) {
+					continue;
+				}
+				double d2 = tracker->distance(blobs[i].centroid, blobs[i].radius);
+				if (closest < 0 || d2 < closest) {
+					closest = d2;
+					chosen = i;
+				}
+			}
+			blobs_size = 0;
+		}
 
-			// Approximate polygon curve with specified position
-			approxPolyDP(Mat(correctContour), correctContour, 3, true);
-			minEnclosingCircle((Mat)correctContour, *center, *radius);
-			// maxEnclosingCircle((Mat)correctContour, *center, *radius);
-			// avg_radius = (*min_radius + *max_radius)/2.f;
-			// avg_center = (*min_center + *max_center)/2.f;
+		for (int i = 0; i < blobs_size; i++){
+			chosen = largest_blobs[i];
 
 			// Filter on movement of the Center
-			dist_center = (norm(*center - prev_center) * ACTUAL_DIAMETER_IN_CM) / (2.0 * (*radius));
-			dist_radius = fabs((*radius - prev_radius) * ACTUAL_DIAMETER_IN_CM) / (2.0 * (*radius));
+			float blob_radius = blobs[chosen].radius;
+			dist_center = (norm(blobs[chosen].centroid - prev_center) * ACTUAL_DIAMETER_IN_CM) / (2.0 * blob_radius);
+			dist_radius = fabs((blob_radius - prev_radius) * ACTUAL_DIAMETER_IN_CM) / (2.0 * blob_radius);
 			
 			if (dist_center < MAX_OBJ_DIST_BW_FRAMES && dist_radius < MAX_OBJ_DIST_BW_FRAMES){
 				break;
 			}
 		}
+	}
+
+	// nothing round enough
+	if (chosen < 0) {
+		return;
+	}
+
+	// center and radius straight from the blob's moments
+	*center = blobs[chosen].centroid;
+	*radius = blobs[chosen].radius;
 
-		if (*radius > radialBias) {
+	// only an ambiguous score looks at the pixels
+	bool isCircle = check == NULL || verifyCircle(blobs[chosen], &check->scores[chosen], check);
+
+	if (*radius > radialBias) {
+		if (isCircle) {
+			*mark = MARK_FOUND;
 			if (isObject) {
-				// might not be object we're looking for
-				circle(*frame, *center, 3, Scalar(147, 20, 32), 3, 8, 0);
-				circle(*frame, *center, (int)*radius, Scalar(0, 255, 0), 2, 8, 0);
 				*isOffscreen = false;
-			} else {
-				circle(*frame, *center, 3, Scalar(255, 101, 255), 3, 8, 0);
-				circle(*frame, *center, (int)*radius, Scalar(255, 0, 0), 2, 8, 0);
-			}
-		} else {
-			if (isObject) {
-				if (circles.size() > 0) {
-					// for sure this is the object we are looking for
-					for (int i = 0; i < circles.size(); i++) {
-						Point circleCenter = Point(cvRound(circles[i][0]), cvRound(circles[i][1]));
-						if (abs(circleCenter.x - (*center).x) < bias && abs(circleCenter.y - (*center).y) < bias) {
-							circle(*frame, *center, 3, Scalar(139, 100, 54), 3, 8, 0);
-							circle(*frame, *center, (int)*radius, Scalar(0, 255, 0), 2, 8, 0);
-							*isOffscreen = true;
-						}
-					}
-				} else {
-					circle(*frame, *center, 3, Scalar(0, 0, 255), 3, 8, 0);
-					circle(*frame, *center, (int)*radius, Scalar(0, 0, 255), 2, 8, 0);
-					*isOffscreen = true;
-				}
 			}
 		}
+	} else if (isObject) {
+		// too small to be sure of, even when it is round
+		*mark = isCircle ? MARK_CIRCLE : MARK_SMALL;
+		*isOffscreen = true;
 	}
 }
 
 // play around with bias to get more sensitive readings
-void detectDirection(Mat *frame, deque <Point2f> points, int pt_size, string *direction, int x_bias, int y_bias) {
+void detectDirection(const TrackHistory &history, direction_t *direction, int x_bias, int y_bias) {
 	int dX = 0;
 	int dY = 0;
-	char dXdY[50] = "";
-	string latDirection = "";
-	string longDirection = "";
-
-	if (points.size() > 10) {
-		// find change in x and y using points from queue
-		dX = (points[pt_size - 10]).x - (points[pt_size]).x;
-		dY = (points[pt_size - 10]).y - (points[pt_size]).y;
-		sprintf(dXdY, "dx: %d dy: %d", dX, dY);
+	direction_t latDirection = DIRECTION_STATIONARY;
+	direction_t longDirection = DIRECTION_STATIONARY;
+
+	if (history.size() > 10) {
+		// find change in x and y over the last 10 frames
+		dX = history.back(10).x - history.newest().x;
+		dY = history.back(10).y - history.newest().y;
 		if (abs(dX) > x_bias) {
 			if (dX > 0) {
-				latDirection = "West";
+				latDirection = DIRECTION_WEST;
 			} else {
-				latDirection = "East";
+				latDirection = DIRECTION_EAST;
 			}
 		}
 		if (abs(dY) > y_bias) {
 			if (dY > 0) {
-				longDirection = "North";
+				longDirection = DIRECTION_NORTH;
 			} else {
-				longDirection = "South";
+				longDirection = DIRECTION_SOUTH;
 			}
 		}
-		if (!longDirection.empty() && !latDirection.empty()) {
-			*direction = longDirection + "-" + latDirection;
-		} else if (!longDirection.empty()){
-			*direction = longDirection;
-		} else if (!latDirection.empty()) {
-			*direction = latDirection;
+		if (longDirection != DIRECTION_STATIONARY || latDirection != DIRECTION_STATIONARY) {
+			*direction = longDirection | latDirection;
 		}
 	}
-
-	putText(*frame, dXdY, Point(10, 450), FONT_HERSHEY_SIMPLEX, 1, Scalar(0, 0, 255));
 }
 
-float getMotionAngle (Mat *frame, deque <Point2f> points, int pt_size) {
-	char ang[50] = "";
-	if (points.size() > 1) {
-		Point2f diff_point = points[pt_size - 1] - points[pt_size];
+float getMotionAngle (const TrackHistory &history) {
+	if (history.size() > 1) {
+		Point2f diff_point = history.back(1) - history.newest();
 		double angle1 = asin(diff_point.y / norm(diff_point));
 		angle1 = angle1 * 180.f / PI;
-		sprintf(ang, "angle: %f", angle1);
-		putText(*frame, ang, Point(10, 350), FONT_HERSHEY_SIMPLEX, 1, Scalar(0, 0, 255));
 		return angle1;		
 	}
+	// no motion to measure yet
+	return NAN;
 }
 
 // Returns observed drive distance when object is done driving
-float getObservedDriveDist (string prev_direction, string direction, Point2f *startCenter, Point2f objectCenter, float radius, int *lenPath,
+float getObservedDriveDist (direction_t prev_direction, direction_t direction, Point2f *startCenter, Point2f objectCenter, float radius, int *lenPath,
 	float *totAngle, float angle, float avgAngle, float angleBias) {
-	if (prev_direction == "Stationary" && direction != "Stationary" && *startCenter==Point2f()){
+	if (prev_direction == DIRECTION_STATIONARY && direction != DIRECTION_STATIONARY && *startCenter==Point2f()){
 		cout << "Made it to the initializer case!" << endl;
 		*startCenter = objectCenter;
 		if (angle != angle){
@@ -275,7 +274,7 @@ float getObservedDriveDist (string prev_direction, string direction, Point2f *st
 		}
 		return NULL;
 	}
-	if (prev_direction != "Stationary" && direction == "Stationary" && *startCenter!=Point2f()){
+	if (prev_direction != DIRECTION_STATIONARY && direction == DIRECTION_STATIONARY && *startCenter!=Point2f()){
 		float dist = norm(*startCenter - objectCenter);
 		*startCenter = Point2f();
 		cout << "Made it to the end case!" << endl;
@@ -290,7 +289,7 @@ float getObservedDriveDist (string prev_direction, string direction, Point2f *st
 	return NULL;
 }
 
-float updatePerspectiveAngle (float *perspective, float observedDist, float actualDist, float angle) {
+void updatePerspectiveAngle (float *perspective, float observedDist, float actualDist, float angle) {
 	if (observedDist != NULL){
 		cout << "observedDist: " << observedDist << endl;
 		cout << "actualDist: " << actualDist << endl;
@@ -313,21 +312,118 @@ void getAverageMotionAngle (float *avgAngle, float totAngle, int lenPath) {
 	*avgAngle = 0;
 }
 
-float getAverageRadius (deque <float> radii, int radiiSize) {
-	float total = 0;
-	for (int i = 0; i < radiiSize; i++) {
-		total += radii[i];
+float getAverageRadius (const TrackHistory &history) {
+	return history.meanRadius();
+}
+
+Point2f getAveragePoint (const TrackHistory &history) {
+	return history.meanCenter();
+}
+
+// Window around where the target must be this frame, sized from its radius and
+// the expected speed. Every frame it is missed the window grows by another
+// step, and past TRACK_MAX_MISSES it becomes the full frame until relocked.
+Rect getSearchWindow(roiTrack_t *track, Point2f center, float radius, Point2f velocity, Size frameSize) {
+	Rect frameRect(0, 0, frameSize.width, frameSize.height);
+
+	if (!track->locked || track->misses > TRACK_MAX_MISSES) {
+		return frameRect;
+	}
+
+	float speed = max((float)norm(velocity), (float)TRACK_MIN_SPEED);
+	Point2f predicted = center + velocity * (float)(track->misses + 1);
+	int halfSize = cvCeil(TRACK_WINDOW_SCALE * radius + speed * (1 << track->misses));
+
+	Rect window(cvFloor(predicted.x) - halfSize, cvFloor(predicted.y) - halfSize, 2 * halfSize, 2 * halfSize);
+	window &= frameRect;
+	if (window.area() == 0) {
+		return frameRect;
 	}
-	return total / radiiSize;
+	return window;
 }
 
-Point2f getAveragePoint (deque <Point2f> center, float size) {
-	Point2f pointTotal = Point2f(0, 0);
-	for (int i = 0; i < size; i++) {
-		pointTotal += center[i];
+// locks on a hit, counts a miss otherwise. A full frame miss drops the lock.
+void updateTrack(roiTrack_t *track, bool found) {
+	if (found) {
+		track->locked = true;
+		track->misses = 0;
+	} else if (track->locked) {
+		track->misses++;
+		if (track->misses > TRACK_MAX_MISSES + 1) {
+			track->locked = false;
+		}
+	}
+}
+
+// the level asked for, lowered until the coarse frame keeps at least one pixel each way
+int pyramidLevelFor(const Mat &frame, int level) {
+	// a YUYV frame is scaled in pairs, so it is half as wide
+	int width = frame.type() == CV_8UC2 ? frame.cols / 2 : frame.cols;
+	int side = min(width, frame.rows);
+	level = min(max(level, 0), PYRAMID_MAX_LEVEL);
+	while (level > 0 && (side >> level) < 1) {
+		level--;
+	}
+	return level;
+}
+
+// Coarse pass of the pyramid detection mode. Segments the frame downscaled by
+// 2^level and returns, per target, the largest blob's bounding box scaled back
+// to full resolution so the fine pass only refines inside it. A target with
+// no coarse hit keeps the full frame.
+void getPyramidWindows(Mat *frame, const colorTargets_t &targets, int level, vector<Rect> *windows, pyramidWorkspace_t *work) {
+	vector<BitMask> &masks = work->masks;
+	vector<blob_t> &blobs = work->blobs;
+	Rect frameRect(0, 0, frame->cols, frame->rows);
+	int numTargets = targets.ranges.size();
+
+	// pyramidDown smooths as it scales, so it stands in for the full resolution blur
+	// a YUYV frame is scaled pair by pair, so U and V are never averaged together
+	bool isYUYV = frame->type() == CV_8UC2;
+	work->levels.resize(level + 1);
+	work->levels[0] = isYUYV ? yuyvPairs(*frame) : *frame;
+	for (int i = 0; i < level; i++) {
+		pyramidDown(work->levels[i], &work->levels[i + 1], &work->blur);
+	}
+	thresholdTargets(isYUYV ? yuyvPixels(work->levels[level]) : work->levels[level], targets, &masks);
+
+	windows->resize(numTargets);
+	for (int t = 0; t < numTargets; t++) {
+		cleanMask(&masks[t], &work->temp);
+		extractBlobs(masks[t], Point(), &blobs, &work->blobWork);
+
+		int largest = largestBlob(blobs);
+		if (largest < 0) {
+			(*windows)[t] = frameRect;
+			continue;
+		}
+		Rect box = blobs[largest].box;
+
+		// back to full resolution, padded for the pixels lost when downscaling
+		int margin = PYRAMID_MARGIN << level;
+		Rect window((box.x << level) - margin, (box.y << level) - margin,
+					(box.width << level) + 2 * margin, (box.height << level) + 2 * margin);
+		(*windows)[t] = window & frameRect;
 	}
+}
 
-	return Point2f(pointTotal.x/size, pointTotal.y/size);
+// reads bounds saved by calibrate, one value per line: low H, high H, low S, high S, low V, high V.
+// The bounds are left alone when the file is missing or short
+bool loadHSV(const char *fileName, Scalar *lowerBound, Scalar *upperBound) {
+	ifstream infile(fileName);
+	string curr_line;
+	int hsvArr[6];
+	int i = 0;
+	while (i < 6 && getline(infile, curr_line)) {
+		hsvArr[i] = atoi(curr_line.c_str());
+		i++;
+	}
+	if (i > 5) {
+		*lowerBound = Scalar(hsvArr[0], hsvArr[2], hsvArr[4]);
+		*upperBound = Scalar(hsvArr[1], hsvArr[3], hsvArr[5]);
+		return true;
+	}
+	return false;
 }
 
 void userInput(VideoCapture cap, Scalar *lowerBound, Scalar *upperBound, char *fileName) {
@@ -343,247 +439,709 @@ void userInput(VideoCapture cap, Scalar *lowerBound, Scalar *upperBound, char *f
 		outfile.open(fileName);
 		calibrate(cap, lowerBound, upperBound, outfile);
 	} else {
-		infile.open(fileName);
-		string curr_line;
-		int hsvArr[6];
-		int i = 0;
-		while (getline(infile, curr_line)) {
-			hsvArr[i] = atoi(curr_line.c_str());
-			i++;
+		loadHSV(fileName, lowerBound, upperBound);
+	}
+}
+
+// Grabs the next frame into the packet and converts it to BGR, or with keepYUYV
+// leaves a YUYV frame as it is. Frames that do not decode are skipped and
+// counted, false once the source has no more frames or too many in a row failed.
+static bool capturePacket(VideoCapture *cap, FrameSource *source, bool keepYUYV, framePacket_t *packet, int *skipped) {
+	int failed = 0;
+	while (true) {
+		packet->captured.index = -1;
+		if (source != NULL) {
+			if (!source->grab(&packet->captured)) {
+				return false;
+			}
+			if (keepYUYV && packet->captured.fourcc == V4L2_PIX_FMT_YUYV) {
+				packet->frame = packet->captured.image;
+			} else {
+				frameToBGR(packet->captured, &packet->frame);
+			}
+		} else {
+			if (!cap->read(packet->frame)) {
+				return false;
+			}
+			packet->captured.timestampUs = monotonicUs();
+		}
+
+		if (!packet->frame.empty()) {
+			return true;
+		}
+		// e.g. a torn MJPEG frame, the buffer goes straight back and the next frame is tried
+		if (source != NULL) {
+			source->release(&packet->captured);
 		}
-		if (i > 5) {
-			*lowerBound = Scalar(hsvArr[0], hsvArr[2], hsvArr[4]);
-			*upperBound = Scalar(hsvArr[1], hsvArr[3], hsvArr[5]);
+		(*skipped)++;
+		if (++failed == CAPTURE_MAX_BAD_FRAMES) {
+			cout << "Capture: " << failed << " frames in a row did not decode, stopping" << endl;
+			return false;
 		}
 	}
 }
 
-//default camera at 0
-int analyzeVideo() {
-	VideoCapture cap;
-	deque <Point2f> objectPoints;
-	deque <Point2f> destPoints;
-	deque <float> objectRadii;
-	deque <float> destRadii;
+// Captures frames and converts them to BGR, stops at the end of the video or when asked.
+// With keepYUYV, YUYV frames are passed on unconverted for the YUV segmentation.
+static void captureStage(VideoCapture *cap, FrameSource *source, bool keepYUYV, packetRing_t *freePackets,
+						 stageChannel_t *out, atomic<bool> *stopping) {
+	StageStats stats("capture");
+	framePacket_t *packet;
+	int skipped = 0;
+	traceThreadName("capture");
+
+	// a packet comes back to the pool once the statechart stage is done with it
+	while (!*stopping && freePackets->pop(&packet)) {
+		stats.begin();
+		bool grabbed;
+		{
+			// ends before the push, a wait on the segment stage is not capture time
+			TRACE_SCOPE("capture");
+			grabbed = capturePacket(cap, source, keepYUYV, packet, &skipped);
+			// Later stages only read the BGR copy, so the driver gets its buffer back
+			// now. A YUYV frame segmented in place still views it until the statechart is done.
+			if (grabbed && source != NULL && packet->frame.data != packet->captured.image.data) {
+				source->release(&packet->captured);
+			}
+		}
+		if (!grabbed) {
+			cout << "Empty Frame!" << endl;
+			break;
+		}
+		stats.end();
 
-	// Set up camera
-	if (!cap.open(1)) {
-		cout << "Error detecting camera1" << endl;
-		if (!cap.open(0)) {
-			cout << "Error detecting camera0" << endl;
-			return -1;
+		if (!out->push(packet)) {
+			break;
 		}
 	}
+	if (skipped > 0) {
+		cout << "Capture: skipped " << skipped << " frames that did not decode" << endl;
+	}
+	out->close();
+}
 
-	Scalar lowerBoundObject = Scalar(0, 0, 0);
-	Scalar upperBoundObject = Scalar(120, 255, 255);
+// Columns from..to-1 of a cache row from a row of src, whose column 0 lies at
+// column origin of the cache. Words only partly in the range keep their other bits.
+static void mergeBits(const BitMask &src, int srcY, int origin, int from, int to, uint64_t *dst) {
+	const uint64_t *s = src.row(srcY);
+	for (int w = from / 64; w <= (to - 1) / 64; w++) {
+		int lo = max(from - w * 64, 0);
+		int hi = min(to - w * 64, 64);
+		uint64_t keep = (hi == 64 ? ~0ULL : (1ULL << hi) - 1) & ~((1ULL << lo) - 1);
+
+		// the 64 source bits that line up with word w
+		int bit = w * 64 - origin;
+		uint64_t bits;
+		if (bit >= 0) {
+			int sw = bit / 64;
+			int shift = bit % 64;
+			bits = s[sw] >> shift;
+			if (shift != 0 && sw + 1 < src.wordsPerRow) {
+				bits |= s[sw + 1] << (64 - shift);
+			}
+		} else {
+			bits = s[0] << -bit;
+		}
+		dst[w] = (dst[w] & ~keep) | (bits & keep);
+	}
+}
 
-	Scalar lowerBoundDest = Scalar(0, 0, 0);
-	Scalar upperBoundDest = Scalar(120, 255, 255);
+// Change detection mode. Only the tiles whose luma moved since they were last
+// segmented are thresholded again, the rest of each mask comes from the cache.
+// Returns false when no tile changed, the packet's masks are then left as they are.
+static bool segmentChangedTiles(framePacket_t *packet, const colorTargets_t &targets, segmentWorkspace_t *work) {
+	Mat &frame = packet->frame;
+	Rect frameRect(0, 0, frame.cols, frame.rows);
+	int numTargets = targets.ranges.size();
 
-	// for calibrating Object
-	userInput(cap, &lowerBoundObject, &upperBoundObject, "Object-HSV.txt");
-	// for calibrating Destination
-	userInput(cap, &lowerBoundDest, &upperBoundDest, "Destination-HSV.txt");
+	if (work->changes.update(frame) == 0) {
+		return false;
+	}
 
-	namedWindow("drawing", WINDOW_NORMAL);
-	resizeWindow("drawing", 600, 600);
+	work->cache.resize(numTargets);
+	for (int t = 0; t < numTargets; t++) {
+		if (work->cache[t].rows != frame.rows || work->cache[t].cols != frame.cols) {
+			work->cache[t].create(frame.rows, frame.cols);
+		}
+	}
 
-	Point2f objectCenter;
-	Point2f prev_objectCenter = objectCenter;
-	Point2f destCenter;
-	Point2f prev_destCenter = destCenter;
-	float objectRadius;
-	float prev_objectRadius;
-	float destRadius;
-	float prev_destRadius;
+	// The blur carries a change up to its radius into the tiles around a run,
+	// which did not change themselves. So each run is segmented padded by the
+	// radius, blurring with the real pixels around it, and the whole padded area
+	// goes back into the cache. That keeps the cache equal to a full frame pass.
+	work->changes.changedRuns(&work->runs);
+	for (int i = 0; i < work->runs.size(); i++) {
+		Rect run = work->runs[i];
+		Rect padded(run.x - BLUR_MAX_RADIUS, run.y - BLUR_MAX_RADIUS, run.width + 2 * BLUR_MAX_RADIUS,
+					run.height + 2 * BLUR_MAX_RADIUS);
+		padded = alignWindow(frame, padded & frameRect);
+		Mat roi = frame(padded);
+		segmentFrame(&roi, targets, &work->runMasks, &work->blur);
+
+		for (int t = 0; t < numTargets; t++) {
+			for (int y = 0; y < padded.height; y++) {
+				mergeBits(work->runMasks[t], y, padded.x, padded.x, padded.x + padded.width,
+						  work->cache[t].row(padded.y + y));
+			}
+		}
+	}
+	work->changes.accept();
 
-	string prev_direction = "Stationary";
-	string direction = "Stationary";
-	Point2f startCenter = Point2f();
-	float dist;
-	float angle;
-	int lenPath=0;
-	float perspectiveAngle = 45;
-	float avgAngle = 0;
-	float totAngle = 0;
+	packet->windows.assign(numTargets, frameRect);
+	packet->masks.resize(numTargets);
+	for (int t = 0; t < numTargets; t++) {
+		packet->masks[t] = work->cache[t];
+		cleanMask(&packet->masks[t], &work->maskTemp);
+	}
+	return true;
+}
 
+// places the search windows from the last detection and segments both targets
+void segmentPacket(framePacket_t *packet, const colorTargets_t &targets, trackShare_t *share, segmentWorkspace_t *work) {
+	Mat &frame = packet->frame;
 
-	// loop to capture and analyze frames
-	while(1) {
-		direction = "Stationary";
-		vector<string> output = {"", "", ""};
+	// with -u the tracking windows are not used, the cache covers the whole frame
+	packet->unchanged = false;
+	if (changeMode) {
+		packet->unchanged = !segmentChangedTiles(packet, targets, work);
+		return;
+	}
 
-		bool isOffscreen = true;
-		Mat frame, mask, destMask;
-		cap.read(frame);
+	// predicts where the object and destination must be from the last detection
+	Rect frameRect(0, 0, frame.cols, frame.rows);
+	vector<Rect> &windows = packet->windows;
+	windows.resize(2);
+	windows[OBJECT_TARGET] = frameRect;
+	windows[DEST_TARGET] = frameRect;
+	if (trackMode) {
+		unique_lock<mutex> l(share->lock);
+		// the detect stage is a frame behind, so the object is moved on by one more step
+		windows[OBJECT_TARGET] = getSearchWindow(&share->objectTrack, share->objectCenter + share->objectVelocity,
+												 share->objectRadius, share->objectVelocity, frame.size());
+		windows[DEST_TARGET] = getSearchWindow(&share->destTrack, share->destCenter, share->destRadius, Point2f(), frame.size());
+		// a full frame pass is needed anyway, so segment both targets in it
+		if (windows[OBJECT_TARGET] == frameRect || windows[DEST_TARGET] == frameRect) {
+			windows[OBJECT_TARGET] = frameRect;
+			windows[DEST_TARGET] = frameRect;
+		}
+	}
 
-		if (frame.empty()) {
-			cout << "Empty Frame!" << endl;
-			break;
+	// without a tracked window, finds the targets coarsely on a smaller pyramid level first
+	int level = pyramidLevelFor(frame, pyramidLevel);
+	if (level > 0 && windows[OBJECT_TARGET] == frameRect && windows[DEST_TARGET] == frameRect) {
+		getPyramidWindows(&frame, targets, level, &windows, &work->pyramid);
+	}
+
+	for (int t = 0; t < windows.size(); t++) {
+		windows[t] = alignWindow(frame, windows[t]);
+	}
+
+	// creates the object and destination masks from HSV values in one pass
+	segmentWindows(&frame, targets, windows, &packet->masks, &work->blur);
+
+	// cleans the mask for the object, its shape is checked on the blobs
+	cleanMask(&packet->masks[OBJECT_TARGET], &work->maskTemp);
+
+	// cleans the mask for the destination
+	cleanMask(&packet->masks[DEST_TARGET], &work->maskTemp);
+}
+
+void initDetectState(detectState_t *state) {
+	state->prev_timestampUs = 0;
+	state->objectTrack.locked = false;
+	state->objectTrack.misses = 0;
+	state->destTrack = state->objectTrack;
+	state->objectCenter = Point2f();
+	state->prev_objectCenter = state->objectCenter;
+	state->destCenter = Point2f();
+	state->prev_destCenter = state->destCenter;
+	state->objectRadius = 0;
+	state->prev_objectRadius = 0;
+	state->destRadius = 0;
+	state->prev_destRadius = 0;
+	state->prev_direction = DIRECTION_STATIONARY;
+	state->direction = DIRECTION_STATIONARY;
+	state->startCenter = Point2f();
+	state->dist = 0;
+	state->angle = 0;
+	state->lenPath = 0;
+	state->perspectiveAngle = 45;
+	state->avgAngle = 0;
+	state->totAngle = 0;
+	state->hasDetection = false;
+}
+
+// finds the targets in the masks, tracks their motion and works out the statechart inputs
+void detectPacket(framePacket_t *packet, trackShare_t *share, detectState_t *state, PreviewRenderer *preview) {
+	vector<blob_t> &blobs = state->blobs;
+	vector<blob_t> &destBlobs = state->destBlobs;
+	blobWorkspace_t &blobWork = state->blobWork;
+	TrackHistory &objectHistory = state->objectHistory;
+	TrackHistory &destHistory = state->destHistory;
+	KalmanTracker &objectKalman = state->objectKalman;
+	previewOverlay_t &overlay = state->overlay;
+	int64_t &prev_timestampUs = state->prev_timestampUs;
+	roiTrack_t &objectTrack = state->objectTrack;
+	roiTrack_t &destTrack = state->destTrack;
+	Point2f &objectCenter = state->objectCenter;
+	Point2f &prev_objectCenter = state->prev_objectCenter;
+	Point2f &destCenter = state->destCenter;
+	Point2f &prev_destCenter = state->prev_destCenter;
+	float &objectRadius = state->objectRadius;
+	float &prev_objectRadius = state->prev_objectRadius;
+	float &destRadius = state->destRadius;
+	float &prev_destRadius = state->prev_destRadius;
+	direction_t &prev_direction = state->prev_direction;
+	direction_t &direction = state->direction;
+	Point2f &startCenter = state->startCenter;
+	float &dist = state->dist;
+	float &angle = state->angle;
+	int &lenPath = state->lenPath;
+	float &perspectiveAngle = state->perspectiveAngle;
+	float &avgAngle = state->avgAngle;
+	float &totAngle = state->totAngle;
+
+	Mat &frame = packet->frame;
+
+	// moves the object's estimate on to this frame, under the last command Maxwell was given
+	double dt = prev_timestampUs != 0 ? (packet->captured.timestampUs - prev_timestampUs) / 1e6 : 0;
+	prev_timestampUs = packet->captured.timestampUs;
+	{
+		unique_lock<mutex> l(share->lock);
+		objectKalman.command(share->lastCommand);
+	}
+	objectKalman.predict(dt);
+
+	// Nothing in view moved, so the last detection still holds. The object is
+	// then standing still, whatever direction it last had. The filter and the
+	// histories still see the frame, as a repeat of the last measurement.
+	if (packet->unchanged && state->hasDetection) {
+		if (objectTrack.locked && objectTrack.misses == 0) {
+			objectKalman.correct(prev_objectCenter, prev_objectRadius);
+		} else {
+			objectKalman.miss();
+		}
+		objectHistory.push(prev_objectCenter, prev_objectRadius);
+		destHistory.push(prev_destCenter, prev_destRadius);
+
+		detection_t &last = state->lastDetection;
+		last.direction = DIRECTION_STATIONARY;
+		packet->driveDistance = last.driveDistance;
+		packet->isOffscreen = last.isOffscreen;
+		packet->objectPoint = last.objectPoint;
+		packet->objectRadius = last.objectRadius;
+		packet->destPoint = last.destPoint;
+		packet->destRadius = last.destRadius;
+		packet->direction = last.direction;
+		if (preview != NULL) {
+			preview->submit(frame, overlay);
 		}
+		return;
+	}
 
-		// creates a mask from HSV values and circle detection for the object
-		vector<Vec3f> circles;
-		filterImage(&frame, &mask, lowerBoundObject, upperBoundObject, circles, true);
-
-		// creates a mask from HSV values and circle detection for the destination
-		vector<Vec3f> destCircles;
-		filterImage(&frame, &destMask, lowerBoundDest, upperBoundDest, destCircles, false);
-
-		// finds Contours for the Object
-		vector<vector<Point> > contours;
-		findContours(mask.clone(), contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);
-
-		// finds Contours for the Destination
-		vector<vector<Point> > destContours;
-		findContours(destMask.clone(), destContours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);
-
-		// detects the object and draws to the frame
-		// gives the center and radius of the object
-		detectObject(&frame, circles, contours, &objectCenter, prev_objectCenter, &objectRadius, prev_objectRadius, true, &isOffscreen); 
-		prev_objectCenter = objectCenter; 
-		prev_objectRadius = objectRadius;
-
-		// detects the destination and draws to the frame
-		// gives the center and radius of the destination
-		detectObject(&frame, destCircles, destContours, &destCenter, prev_destCenter, &destRadius, prev_destRadius, false, &isOffscreen);
-		prev_destCenter = destCenter;
-		prev_objectRadius = objectRadius;
-
-		int obPt_size = objectPoints.size();
-		int destPt_size = destPoints.size();
-		int objectRadii_size = objectRadii.size();
-		int destRadii_size = destRadii.size();
-
-		// add object center points to queue
-		objectPoints.push_back(objectCenter);
-		// add destination center points to queue
-		destPoints.push_back(destCenter);
-		// add radius of object to queue
-		objectRadii.push_back(objectRadius);
-		// add radius of dest ro queue
-		destRadii.push_back(destRadius);
-
-		// draw line to frame from point queue of object movement
-		for (int i = 1; i < obPt_size; i++) {
-			line(frame, objectPoints[i - 1], objectPoints[i], Scalar(43,231,123), 6);
-		}
-
-
-		// detects direction of object movement
-		detectDirection(&frame, objectPoints, obPt_size, &direction);
-
-		// finds angle of object movement and displays to frame
-		angle = getMotionAngle(&frame, objectPoints, obPt_size);
-
-		cout << "previous direction: " << prev_direction << endl;
-		// distance observed by camera (in CM)
-		dist = getObservedDriveDist (prev_direction, direction, &startCenter, prev_objectCenter, prev_objectRadius, &lenPath, &totAngle, angle, avgAngle);
-		prev_direction = direction;
-
-		// get averaged center points from object
-		Point2f avgCenterPoint = getAveragePoint(objectPoints, obPt_size);
-
-		// get averaged center points from destination
-		Point2f avgDestPoint = getAveragePoint(destPoints, destPt_size);
-
-		// gets average radius of object
-		float avgObjectRadius = getAverageRadius(objectRadii, objectRadii_size);
-
-		// gets average radius of destination object
-		float avgDestRadius = getAverageRadius(destRadii, destRadii_size);
-
-		// need to calculate angle and driveDistance
-		// float angle = 0.0;
-		float dx = abs(avgCenterPoint.x - avgDestPoint.x);
-		float dy = abs(avgCenterPoint.y - avgDestPoint.y);
-		float centerDistance = sqrt(dx*dx + dy*dy);
-		// float driveDistance = centerDistance - avgObjectRadius - avgDestRadius;
-		float driveDistance = 829.5;
-		driveDistance = driveDistance/ACTUAL_DIAMETER_IN_CM;
-
-		// update average angle with what totAngle is
-		getAverageMotionAngle(&avgAngle, totAngle, lenPath);
-
-		updatePerspectiveAngle(&perspectiveAngle, dist, driveDistance, avgAngle);
-
-		// update the frame with the perspective angle
-		char perspective[50] = "";
-		sprintf(perspective, "angle: %f", perspectiveAngle);
-		putText(frame, perspective, Point(10, 250), FONT_HERSHEY_SIMPLEX, 1, Scalar(0, 0, 255));
-
-		if (debugMode) {
-			cout << endl;
-			cout << "distance left: " << driveDistance << endl;
-			cout << "offscreen: " << isOffscreen << endl;
-			cout << "object point: " << "(" << avgCenterPoint.x << ", " << avgCenterPoint.y << ")" << endl;
-			cout << "object radius: " << avgObjectRadius << endl;
-			cout << "dest point: " << "(" << avgDestPoint.x << ", " << avgDestPoint.y << ")" << endl;
-			cout << "dest radius: " << avgDestRadius << endl;
-			cout << "direction: " << direction << endl;
-			cout << "perspective angle: " << perspectiveAngle << endl;
-			if (dist != 0){
-				cout << "observed dist: " << dist << endl;
-			}
-			cout << "start point: " << "(" << startCenter.x << ", " << startCenter.y << ")" << endl;
-			cout << "motion angle: " << angle << endl;
-			cout << "lenPath: " << lenPath << endl;
-			cout << "average angle: " << avgAngle << endl;
-			cout << "total angle: " << totAngle << endl;
-			cout << endl;
+	direction = DIRECTION_STATIONARY;
+	bool isOffscreen = true;
+
+	// finds the blobs of the Object, in frame coordinates
+	extractBlobs(packet->masks[OBJECT_TARGET], packet->windows[OBJECT_TARGET].tl(), &blobs, &blobWork);
+
+	// finds the blobs of the Destination
+	extractBlobs(packet->masks[DEST_TARGET], packet->windows[DEST_TARGET].tl(), &destBlobs, &blobWork);
+
+	// detects the object
+	// gives the center and radius of the object
+	state->circleCheck.mask = &packet->masks[OBJECT_TARGET];
+	state->circleCheck.offset = packet->windows[OBJECT_TARGET].tl();
+	detectObject(blobs, &objectCenter, prev_objectCenter, &objectRadius, prev_objectRadius, true, &isOffscreen,
+				 &overlay.objectMark, 10, &objectKalman, &state->circleCheck);
+
+	// corrects the estimate with the detection, or keeps predicting through a dropped or hidden frame.
+	// A round detection outside the gate is not the tracked ball, so until the
+	// filter gives in and restarts from it the object counts as lost this frame.
+	bool objectFound = blobs.size() > 0 && !isOffscreen;
+	if (objectFound && objectKalman.accepts(objectCenter, objectRadius)) {
+		objectKalman.correct(objectCenter, objectRadius);
+	} else if (objectFound) {
+		objectFound = objectKalman.reject(objectCenter, objectRadius);
+		if (!objectFound) {
+			isOffscreen = true;
+			overlay.objectMark = MARK_NONE;
 		}
+	} else {
+		objectKalman.miss();
+	}
+	if (objectKalman.ready()) {
+		objectCenter = objectKalman.center();
+		objectRadius = objectKalman.radius();
+	}
+	prev_objectCenter = objectCenter; 
+	prev_objectRadius = objectRadius;
+
+	// detects the destination
+	// gives the center and radius of the destination
+	detectObject(destBlobs, &destCenter, prev_destCenter, &destRadius, prev_destRadius, false, &isOffscreen,
+				 &overlay.destMark);
+	prev_destCenter = destCenter;
+	prev_destRadius = destRadius;
+
+	// keeps the lock while the object is on screen, widening the window when it is lost
+	updateTrack(&objectTrack, objectFound);
+	updateTrack(&destTrack, destBlobs.size() > 0);
+
+	// add object and destination center and radius to their histories
+	objectHistory.push(objectCenter, objectRadius);
+	destHistory.push(destCenter, destRadius);
+
+	// hands the segment stage what it needs to place the next search windows
+	if (trackMode) {
+		unique_lock<mutex> l(share->lock);
+		share->objectTrack = objectTrack;
+		share->destTrack = destTrack;
+		share->objectCenter = prev_objectCenter;
+		share->objectRadius = prev_objectRadius;
+		// the filter's velocity, in pixels per frame
+		share->objectVelocity = objectKalman.velocity() * (float)dt;
+		share->destCenter = prev_destCenter;
+		share->destRadius = prev_destRadius;
+	}
 
-		output = MaxwellStatechart(
-			driveDistance, 			// distance from object to destination
-			isOffscreen, 			// if Object is isOffscreen
-			avgCenterPoint.x, 		// x point of Object
-			avgCenterPoint.y, 		// y point of Object
-			avgObjectRadius, 		// radius of Object
-			avgDestPoint.x, 		// x point of Destination
-			avgDestPoint.y, 		// y point of Destination
-			avgDestRadius,			// radius of destination
-			direction				// direction object is moving
-		);
+	// detects direction of object movement
+	detectDirection(objectHistory, &direction);
 
+	// finds angle of object movement
+	angle = getMotionAngle(objectHistory);
 
-		if (debugMode) {
-			cout << "FSM output: " << output[0] << ", "<< output[1] << ", " << output[2] << endl;
+	if (debugMode) {
+		cout << "previous direction: " << directionName(prev_direction) << endl;
+	}
+	// distance observed by camera (in CM)
+	dist = getObservedDriveDist (prev_direction, direction, &startCenter, prev_objectCenter, prev_objectRadius, &lenPath, &totAngle, angle, avgAngle);
+	prev_direction = direction;
+
+	// the object's filtered center, it does not lag behind like an average.
+	// Stays at (0, 0) until the object is first found, so the statechart waits
+	Point2f avgCenterPoint = objectKalman.center();
+
+	// get averaged center points from destination
+	Point2f avgDestPoint = getAveragePoint(destHistory);
+
+	// filtered radius of object
+	float avgObjectRadius = objectKalman.radius();
+
+	// gets average radius of destination object
+	float avgDestRadius = getAverageRadius(destHistory);
+
+	// need to calculate angle and driveDistance
+	// float angle = 0.0;
+	float dx = abs(avgCenterPoint.x - avgDestPoint.x);
+	float dy = abs(avgCenterPoint.y - avgDestPoint.y);
+	float centerDistance = sqrt(dx*dx + dy*dy);
+	// float driveDistance = centerDistance - avgObjectRadius - avgDestRadius;
+	float driveDistance = 829.5;
+	driveDistance = driveDistance/ACTUAL_DIAMETER_IN_CM;
+
+	// update average angle with what totAngle is
+	getAverageMotionAngle(&avgAngle, totAngle, lenPath);
+
+	updatePerspectiveAngle(&perspectiveAngle, dist, driveDistance, avgAngle);
+
+	// the preview draws what was detected on its own thread, at its own rate,
+	// the overlay is only filled in for the frames it takes
+	if (preview != NULL) {
+		if (preview->wanted()) {
+			overlay.objectCenter = objectCenter;
+			overlay.objectRadius = objectRadius;
+			overlay.destCenter = destCenter;
+			overlay.destRadius = destRadius;
+			overlay.history = objectHistory;
+			overlay.angle = angle;
+			overlay.perspectiveAngle = perspectiveAngle;
 		}
+		preview->submit(frame, overlay);
+	}
 
-		// store message to threaded buffer
-		bBuffer.deposit(output);
+	if (debugMode) {
+		cout << endl;
+		// capture releases most buffers early, so the latency is shown for every frame, without the driver's sequence
+		cout << "frame latency: " << (monotonicUs() - packet->captured.timestampUs) / 1000.0 << " ms" << endl;
+		cout << "distance left: " << driveDistance << endl;
+		cout << "offscreen: " << isOffscreen << endl;
+		cout << "object point: " << "(" << avgCenterPoint.x << ", " << avgCenterPoint.y << ")" << endl;
+		cout << "object radius: " << avgObjectRadius << endl;
+		Vec3f deviation = objectKalman.deviation();
+		cout << "object deviation: " << "(" << deviation[0] << ", " << deviation[1] << ") radius " << deviation[2] << endl;
+		cout << "dest point: " << "(" << avgDestPoint.x << ", " << avgDestPoint.y << ")" << endl;
+		cout << "dest radius: " << avgDestRadius << endl;
+		cout << "direction: " << directionName(direction) << endl;
+		cout << "perspective angle: " << perspectiveAngle << endl;
+		if (dist != 0){
+			cout << "observed dist: " << dist << endl;
+		}
+		cout << "start point: " << "(" << startCenter.x << ", " << startCenter.y << ")" << endl;
+		cout << "motion angle: " << angle << endl;
+		cout << "lenPath: " << lenPath << endl;
+		cout << "average angle: " << avgAngle << endl;
+		cout << "total angle: " << totAngle << endl;
+		cout << endl;
+	}
 
-		// pop object point queue
-		if (obPt_size >= MAXQUEUESIZE) {
-			objectPoints.pop_front();
+	packet->driveDistance = driveDistance;
+	packet->isOffscreen = isOffscreen;
+	packet->objectPoint = avgCenterPoint;
+	packet->objectRadius = avgObjectRadius;
+	packet->destPoint = avgDestPoint;
+	packet->destRadius = avgDestRadius;
+	packet->direction = direction;
+
+	detection_t &last = state->lastDetection;
+	last.driveDistance = driveDistance;
+	last.isOffscreen = isOffscreen;
+	last.objectPoint = avgCenterPoint;
+	last.objectRadius = avgObjectRadius;
+	last.destPoint = avgDestPoint;
+	last.destRadius = avgDestRadius;
+	last.direction = direction;
+	state->hasDetection = true;
+}
+
+// runs the statechart on a frame's inputs, its command becomes the object filter's control input
+motorCommand_t decidePacket(const framePacket_t *packet, trackShare_t *share) {
+	TRACE_SCOPE("statechart");
+	motorCommand_t output = MaxwellStatechart(
+		packet->driveDistance, 	// distance from object to destination
+		packet->isOffscreen, 	// if Object is isOffscreen
+		packet->objectPoint.x, 	// x point of Object
+		packet->objectPoint.y, 	// y point of Object
+		packet->objectRadius, 	// radius of Object
+		packet->destPoint.x, 	// x point of Destination
+		packet->destPoint.y, 	// y point of Destination
+		packet->destRadius,		// radius of destination
+		packet->direction		// direction object is moving
+	);
+
+	unique_lock<mutex> l(share->lock);
+	share->lastCommand = output.op;
+	return output;
+}
+
+void initTrackShare(trackShare_t *share) {
+	share->objectTrack.locked = false;
+	share->objectTrack.misses = 0;
+	share->destTrack = share->objectTrack;
+	share->objectCenter = Point2f();
+	share->objectVelocity = Point2f();
+	share->objectRadius = 0;
+	share->destCenter = Point2f();
+	share->destRadius = 0;
+	share->lastCommand = MOTOR_NONE;
+}
+
+// the segment step on its own thread
+static void segmentStage(const colorTargets_t &targets, stageChannel_t *in,
+						 stageChannel_t *out, trackShare_t *share) {
+	StageStats stats("segment");
+	segmentWorkspace_t work;
+	framePacket_t *packet;
+	traceThreadName("segment");
+
+	while (in->pop(&packet)) {
+		stats.begin();
+		segmentPacket(packet, targets, share, &work);
+		stats.end();
+
+		if (!out->push(packet)) {
+			break;
 		}
+	}
+	out->close();
+}
 
-		// pop destination point queue
-		if (destPt_size >= MAXQUEUESIZE) {
-			destPoints.pop_front();
+// the detect step on its own thread
+static void detectStage(stageChannel_t *in, stageChannel_t *out, trackShare_t *share,
+						PreviewRenderer *preview) {
+	StageStats stats("detect");
+	detectState_t state;
+	framePacket_t *packet;
+	traceThreadName("detect");
+
+	initDetectState(&state);
+	while (in->pop(&packet)) {
+		stats.begin();
+		detectPacket(packet, share, &state, preview);
+		stats.end();
+
+		if (!out->push(packet)) {
+			break;
 		}
+	}
+	out->close();
+}
 
-		// pop objectRadii queue
-		if (objectRadii_size >= MAXQUEUESIZE) {
-			objectRadii.pop_front();
+// Opens the profile's camera, or camera 1 then 0, at the profile's resolution
+// and exposure. OpenCV's exposure scale depends on the backend, so the value is
+// passed through as the profile gives it.
+static bool openCamera(VideoCapture *cap, const calibrationProfile_t &profile) {
+	if (profile.camera != PROFILE_ANY_CAMERA) {
+		if (!cap->open(profile.camera)) {
+			cout << "Error opening camera " << profile.camera << " from profile " << profile.name << endl;
+			return false;
+		}
+	} else if (!cap->open(1)) {
+		cout << "Error detecting camera1" << endl;
+		if (!cap->open(0)) {
+			cout << "Error detecting camera0" << endl;
+			return false;
 		}
+	}
+	cap->set(CV_CAP_PROP_FRAME_WIDTH, profile.width);
+	cap->set(CV_CAP_PROP_FRAME_HEIGHT, profile.height);
+	if (profile.exposure != PROFILE_AUTO_EXPOSURE) {
+		cap->set(CV_CAP_PROP_EXPOSURE, profile.exposure);
+	}
+	return true;
+}
 
-		// pop destRadii queue
-		if (destRadii_size >= MAXQUEUESIZE) {
-			destRadii.pop_front();
+//default camera at 0
+int analyzeVideo() {
+	VideoCapture cap;
+	calibrationProfile_t profile;
+	defaultProfile(&profile, "default");
+
+	// With -c the bounds and camera settings come from a stored profile and
+	// nothing is asked. Otherwise the operator is prompted for both files.
+	bool isRecording = capturePath != NULL && strncmp(capturePath, "/dev/", 5) != 0;
+	if (profileName != NULL) {
+		if (!findProfile(profilePath, profileName, &profile)) {
+			return -1;
+		}
+		// with -v the frames do not come through cap at all
+		if (capturePath == NULL && !openCamera(&cap, profile)) {
+			return -1;
+		}
+	} else if (isRecording) {
+		// a recording has no camera to calibrate on, so the saved bounds are used without asking
+		if (!loadHSV("Object-HSV.txt", &profile.object.lowerBound, &profile.object.upperBound) ||
+			!loadHSV("Destination-HSV.txt", &profile.destination.lowerBound, &profile.destination.upperBound)) {
+			cout << "Error reading Object-HSV.txt and Destination-HSV.txt for the recording" << endl;
+			return -1;
+		}
+	} else {
+		// Set up camera
+		if (!openCamera(&cap, profile)) {
+			return -1;
 		}
 
-    	imshow("drawing", frame);
+		// for calibrating Object
+		userInput(cap, &profile.object.lowerBound, &profile.object.upperBound, "Object-HSV.txt");
+		// for calibrating Destination
+		userInput(cap, &profile.destination.lowerBound, &profile.destination.upperBound, "Destination-HSV.txt");
+	}
 
-		if (waitKey(30) >= 0) {
-			
-			cap.release();
-			destroyAllWindows();
-			break;
+	// with -v frames come straight from V4L2 buffers or a raw recording instead of cap
+	V4L2Capture camera;
+	FileCapture recording;
+	FrameSource *source = NULL;
+	if (capturePath != NULL) {
+		// the device can only be streamed by one of us at a time
+		cap.release();
+		if (isRecording) {
+			if (!recording.open(capturePath, profile.width, profile.height)) {
+				return -1;
+			}
+			source = &recording;
+		} else {
+			if (!camera.open(capturePath, profile.width, profile.height)) {
+				return -1;
+			}
+			if (profile.exposure != PROFILE_AUTO_EXPOSURE) {
+				camera.setControl(V4L2_CID_EXPOSURE_AUTO, V4L2_EXPOSURE_MANUAL);
+				camera.setControl(V4L2_CID_EXPOSURE_ABSOLUTE, profile.exposure);
+			}
+			source = &camera;
 		}
 	}
+
+	// every target is segmented together from one blurred HSV frame
+	vector<hsvRange_t> targetRanges(2);
+	targetRanges[OBJECT_TARGET] = profile.object;
+	targetRanges[DEST_TARGET] = profile.destination;
+
+	// with -l (BGR) or -y (YUV) the calibrated bounds are baked into a colour table once, here
+	colorTargets_t targets;
+	setColorTargets(&targets, targetRanges, yuvMode ? SEGMENT_YUV : lutMode ? SEGMENT_LUT : SEGMENT_HSV);
+
+	// headless there is no HighGUI at all once calibrated, otherwise only on the preview's thread
+	PreviewRenderer renderer;
+	PreviewRenderer *preview = NULL;
+	if (!headlessMode) {
+		preview = &renderer;
+		preview->start();
+	}
+
+	// Capture, segment and detect run on their own threads so consecutive frames
+	// overlap, the statechart stays on this thread.
+	// Packets go round from a fixed pool, so their buffers are reused.
+	vector<framePacket_t> packets(PACKET_POOL_SIZE);
+	packetRing_t freePackets;
+	stageChannel_t captured;
+	stageChannel_t segmented;
+	stageChannel_t detected;
+	trackShare_t share;
+	initTrackShare(&share);
+	atomic<bool> stopping(false);
+
+	for (int i = 0; i < PACKET_POOL_SIZE; i++) {
+		framePacket_t *packet = &packets[i];
+		freePackets.push(packet);
+	}
+
+	thread captureThread(captureStage, &cap, source, targets.engine == SEGMENT_YUV, &freePackets, &captured, &stopping);
+	thread segmentThread(segmentStage, cref(targets), &captured, &segmented, &share);
+	thread detectThread(detectStage, &segmented, &detected, &share, preview);
+
+	StageStats stats("statechart");
+	framePacket_t *packet;
+	traceThreadName("statechart");
+	while (detected.pop(&packet)) {
+		// after a key press the rest of the pipeline is only drained
+		if (!stopping) {
+			stats.begin();
+			motorCommand_t output = decidePacket(packet, &share);
+
+			if (debugMode) {
+				cout << "FSM output: " << motorOpName(output.op) << ", "<< output.value << ", " << output.speed << endl;
+			}
+
+			// hand the command to the thread sending it to Maxwell, only waits on it with -q
+			{
+				TRACE_SCOPE("deposit");
+				postCommand(output);
+			}
+			stats.end();
+		}
+
+		// done with the frame, a buffer capture kept for it can be filled again
+		if (source != NULL) {
+			source->release(&packet->captured);
+		}
+		freePackets.push(packet);
+
+		// a key pressed in the preview stops the robot's vision
+		if (!stopping && preview != NULL && preview->quitRequested()) {
+			stopping = true;
+		}
+	}
+
+	captureThread.join();
+	segmentThread.join();
+	detectThread.join();
+	if (preview != NULL) {
+		preview->stop();
+	}
 	cap.release();
+	if (source != NULL) {
+		source->close();
+	}
 
 	return 0;
 }
@@ -11,30 +11,181 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
 #include "../Globals/externals.h"
 #include "FSM.h"
+#include "segment.h"
+#include "blob.h"
+#include "circleVerify.h"
+#include "trackHistory.h"
+#include "kalmanTracker.h"
+#include "preview.h"
+#include "v4l2Capture.h"
+#include "changeDetect.h"
+#include "../Globals/stageStats.h"
+#include "../Globals/channel.h"
 
 #define PI 3.14159265
-#define MAXQUEUESIZE 32
 #define MAXSIZE 5
 #define MAX_OBJ_DIST_BW_FRAMES 10
 #define ACTUAL_DIAMETER_IN_CM 23.7
+#define OBJECT_TARGET 0
+#define DEST_TARGET 1
+#define TRACK_WINDOW_SCALE 1.5
+#define TRACK_MIN_SPEED 8
+#define TRACK_MAX_MISSES 3
+#define PYRAMID_MARGIN 4
+// deepest coarse pass -p takes, 1/16 scale
+#define PYRAMID_MAX_LEVEL 4
+#define STAGE_QUEUE_SIZE 1
+// undecodable frames in a row before capture gives up on the source
+#define CAPTURE_MAX_BAD_FRAMES 30
+// every packet that can be in flight: one per queue slot and one per stage
+#define PACKET_POOL_SIZE (3 * STAGE_QUEUE_SIZE + 4)
+// the free packet ring, a power of two that holds the whole pool
+#define PACKET_RING_SIZE 8
+
+// tracking window for one target, locked once it has been found
+typedef struct {
+	bool locked;
+	int misses;
+} roiTrack_t;
+
+// One frame on its way through the pipeline, each stage fills in its part.
+// Packets come from a fixed pool and keep their buffers between frames.
+typedef struct {
+	Mat frame;
+	captureFrame_t captured;
+	// segment stage, one mask per target covering its window
+	vector<Rect> windows;
+	vector<BitMask> masks;
+	// with change detection, nothing moved since the last segmented frame and the masks were not redone
+	bool unchanged;
+	// detect stage, the statechart inputs
+	float driveDistance;
+	bool isOffscreen;
+	Point2f objectPoint;
+	float objectRadius;
+	Point2f destPoint;
+	float destRadius;
+	direction_t direction;
+} framePacket_t;
+
+static_assert(PACKET_POOL_SIZE <= PACKET_RING_SIZE, "free packet ring must hold the whole pool");
+// the queues between pipeline stages, only packet pointers move through them
+typedef Channel<framePacket_t *, STAGE_QUEUE_SIZE> stageChannel_t;
+typedef Channel<framePacket_t *, PACKET_RING_SIZE> packetRing_t;
+
+// latest detection, written by the detect stage and read by the segment stage,
+// and the last command, written by the statechart stage and read by the detect stage
+typedef struct {
+	mutex lock;
+	roiTrack_t objectTrack;
+	roiTrack_t destTrack;
+	Point2f objectCenter;
+	Point2f objectVelocity;
+	float objectRadius;
+	Point2f destCenter;
+	float destRadius;
+	// op of the statechart's last command, the object filter's control input
+	motorOp_t lastCommand;
+} trackShare_t;
+
+// scratch space of the pyramid pass, kept so it is not reallocated every frame
+typedef struct {
+	vector<Mat> levels;
+	blurWorkspace_t blur;
+	vector<BitMask> masks;
+	BitMask temp;
+	vector<blob_t> blobs;
+	blobWorkspace_t blobWork;
+} pyramidWorkspace_t;
+
+// scratch space the segment step keeps between frames
+typedef struct {
+	BitMask maskTemp;
+	blurWorkspace_t blur;
+	pyramidWorkspace_t pyramid;
+	// change detection mode, the full frame masks before cleaning and which tiles to redo
+	ChangeDetector changes;
+	vector<BitMask> cache;
+	vector<BitMask> runMasks;
+	vector<Rect> runs;
+} segmentWorkspace_t;
+
+// the statechart inputs of one frame, what the detect step hands on
+typedef struct {
+	float driveDistance;
+	bool isOffscreen;
+	Point2f objectPoint;
+	float objectRadius;
+	Point2f destPoint;
+	float destRadius;
+	direction_t direction;
+} detection_t;
+
+// everything the detect step carries from one frame to the next
+typedef struct {
+	vector<blob_t> blobs;
+	vector<blob_t> destBlobs;
+	blobWorkspace_t blobWork;
+	TrackHistory objectHistory;
+	TrackHistory destHistory;
+	KalmanTracker objectKalman;
+	circleCheck_t circleCheck;
+	previewOverlay_t overlay;
+	int64_t prev_timestampUs;
+	roiTrack_t objectTrack;
+	roiTrack_t destTrack;
+	Point2f objectCenter;
+	Point2f prev_objectCenter;
+	Point2f destCenter;
+	Point2f prev_destCenter;
+	float objectRadius;
+	float prev_objectRadius;
+	float destRadius;
+	float prev_destRadius;
+	direction_t prev_direction;
+	direction_t direction;
+	Point2f startCenter;
+	float dist;
+	float angle;
+	int lenPath;
+	float perspectiveAngle;
+	float avgAngle;
+	float totAngle;
+	// re-emitted for frames where nothing changed
+	bool hasDetection;
+	detection_t lastDetection;
+} detectState_t;
 
 using namespace cv;
 using namespace std;
 
 void calibrate(VideoCapture cap, Scalar *lowerBound, Scalar *upperBound, ofstream &file);
-void filterImage(Mat *frame, Mat *mask, Scalar lowerBound, Scalar upperBound,
-				 vector<Vec3f> circles, bool isObject);
-void detectObject(Mat *frame, vector<Vec3f> circles, vector<vector<Point> > contours, Point2f *center, Point2f prev_center,
-				  float *radius, float prev_radius, bool isObject, bool *isOffscreen, int bias=10, int radialBias=10);
-void detectDirection(Mat *frame, deque <Point2f> points, int pt_size, string *direction, int x_bias=10, int y_bias=10);
-float getMotionAngle (Mat *frame, deque <Point2f> points, int pt_size);
-float getObservedDriveDist (string prev_direction, string direction, Point2f *startCenter, Point2f objectCenter, float radius, int *lenPath,
+void filterImage(Mat *frame, Mat *mask, Scalar lowerBound, Scalar upperBound);
+void filterMask(BitMask *bits, BitMask *temp, Mat *mask);
+void detectObject(const vector<blob_t> &blobs, Point2f *center, Point2f prev_center,
+				  float *radius, float prev_radius, bool isObject, bool *isOffscreen, int *mark, int radialBias=10,
+				  const KalmanTracker *tracker=NULL, circleCheck_t *check=NULL);
+void detectDirection(const TrackHistory &history, direction_t *direction, int x_bias=10, int y_bias=10);
+float getMotionAngle (const TrackHistory &history);
+float getObservedDriveDist (direction_t prev_direction, direction_t direction, Point2f *startCenter, Point2f objectCenter, float radius, int *lenPath,
 	float *totAngle, float angle, float avgAngle, float angleBias = 15);
-float updatePerspectiveAngle (float *perspective, float observedDist, float actualDist, float *totAngle, float angle, int lenPath);
+void updatePerspectiveAngle (float *perspective, float observedDist, float actualDist, float angle);
+bool loadHSV(const char *fileName, Scalar *lowerBound, Scalar *upperBound);
 void userInput(VideoCapture cap, Scalar *lowerBound, Scalar *upperBound, char *fileName);
-Point2f getAveragePoint (deque <Point2f> center, float size);
-float getAverageRadius (deque <float> radii, int radiiSize);
+Point2f getAveragePoint (const TrackHistory &history);
+float getAverageRadius (const TrackHistory &history);
+Rect getSearchWindow(roiTrack_t *track, Point2f center, float radius, Point2f velocity, Size frameSize);
+void updateTrack(roiTrack_t *track, bool found);
+int pyramidLevelFor(const Mat &frame, int level);
+void getPyramidWindows(Mat *frame, const colorTargets_t &targets, int level, vector<Rect> *windows, pyramidWorkspace_t *work);
+void initTrackShare(trackShare_t *share);
+void initDetectState(detectState_t *state);
+// one frame through each step, the pipeline's stages and the benchmark both run these
+void segmentPacket(framePacket_t *packet, const colorTargets_t &targets, trackShare_t *share, segmentWorkspace_t *work);
+void detectPacket(framePacket_t *packet, trackShare_t *share, detectState_t *state, PreviewRenderer *preview);
+motorCommand_t decidePacket(const framePacket_t *packet, trackShare_t *share);
 int analyzeVideo();
 #endif
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <opencv2/opencv.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "preview.h"
+
+using namespace cv;
+using namespace std;
+
+static void drawMark(Mat *frame, Point2f center, float radius, int mark, bool isObject) {
+	if (!isObject) {
+		if (mark == MARK_FOUND) {
+			circle(*frame, center, 3, Scalar(255, 101, 255), 3, 8, 0);
+			circle(*frame, center, (int)radius, Scalar(255, 0, 0), 2, 8, 0);
+		}
+		return;
+	}
+
+	switch (mark) {
+		case MARK_FOUND:
+			// might not be object we're looking for
+			circle(*frame, center, 3, Scalar(147, 20, 32), 3, 8, 0);
+			circle(*frame, center, (int)radius, Scalar(0, 255, 0), 2, 8, 0);
+			break;
+		case MARK_CIRCLE:
+			// for sure this is the object we are looking for
+			circle(*frame, center, 3, Scalar(139, 100, 54), 3, 8, 0);
+			circle(*frame, center, (int)radius, Scalar(0, 255, 0), 2, 8, 0);
+			break;
+		case MARK_SMALL:
+			circle(*frame, center, 3, Scalar(0, 0, 255), 3, 8, 0);
+			circle(*frame, center, (int)radius, Scalar(0, 0, 255), 2, 8, 0);
+			break;
+	}
+}
+
+// draws the targets, the object's trajectory and the motion readouts
+void drawOverlay(Mat *frame, const previewOverlay_t &overlay) {
+	const TrackHistory &history = overlay.history;
+	char text[50] = "";
+
+	drawMark(frame, overlay.objectCenter, overlay.objectRadius, overlay.objectMark, true);
+	drawMark(frame, overlay.destCenter, overlay.destRadius, overlay.destMark, false);
+
+	// draw line to frame from the history of object movement
+	for (int i = 1; i < history.size(); i++) {
+		line(*frame, history.center(i - 1), history.center(i), Scalar(43,231,123), 6);
+	}
+
+	// change in x and y over the last 10 frames, what the direction is read from
+	if (history.size() > 10) {
+		int dX = history.back(10).x - history.newest().x;
+		int dY = history.back(10).y - history.newest().y;
+		sprintf(text, "dx: %d dy: %d", dX, dY);
+		putText(*frame, text, Point(10, 450), FONT_HERSHEY_SIMPLEX, 1, Scalar(0, 0, 255));
+	}
+
+	if (!isnan(overlay.angle)) {
+		sprintf(text, "angle: %f", overlay.angle);
+		putText(*frame, text, Point(10, 350), FONT_HERSHEY_SIMPLEX, 1, Scalar(0, 0, 255));
+	}
+
+	sprintf(text, "angle: %f", overlay.perspectiveAngle);
+	putText(*frame, text, Point(10, 250), FONT_HERSHEY_SIMPLEX, 1, Scalar(0, 0, 255));
+}
+
+PreviewRenderer::PreviewRenderer(int every) : fresh(false), stopping(false), quit(false), every(every), frames(0) {
+}
+
+PreviewRenderer::~PreviewRenderer() {
+	stop();
+}
+
+void PreviewRenderer::start() {
+	worker = thread(&PreviewRenderer::run, this);
+}
+
+void PreviewRenderer::stop() {
+	{
+		unique_lock<mutex> l(lock);
+		stopping = true;
+	}
+	ready.notify_one();
+	if (worker.joinable()) {
+		worker.join();
+	}
+}
+
+void PreviewRenderer::submit(const Mat &frame, const previewOverlay_t &overlay) {
+	if (frames++ % every != 0) {
+		return;
+	}
+
+	// the copy is made into our own buffer, so the renderer is never held up by it
+	frame.copyTo(filling);
+	{
+		unique_lock<mutex> l(lock);
+		// an undrawn frame is simply replaced, its buffer is the next one filled
+		swap(filling, pending);
+		pendingOverlay = overlay;
+		fresh = true;
+	}
+	ready.notify_one();
+}
+
+// every HighGUI call stays on this thread
+void PreviewRenderer::run() {
+	namedWindow(PREVIEW_WINDOW, WINDOW_NORMAL);
+	resizeWindow(PREVIEW_WINDOW, 600, 600);
+
+	while (true) {
+		bool draw = false;
+		{
+			unique_lock<mutex> l(lock);
+			ready.wait_for(l, chrono::milliseconds(PREVIEW_IDLE_MS), [this](){ return fresh || stopping; });
+			if (stopping) {
+				break;
+			}
+			if (fresh) {
+				// takes the frame and leaves the slot our old buffer to fill
+				swap(pending, drawing);
+				overlay = pendingOverlay;
+				fresh = false;
+				draw = true;
+			}
+		}
+
+		// without a new frame the pass only pumps the window's events
+		if (draw) {
+			// YUYV frames of the YUV segmentation are only converted here, for display
+			Mat *shown = &drawing;
+			if (drawing.type() == CV_8UC2) {
+				cvtColor(drawing, converted, COLOR_YUV2BGR_YUYV);
+				shown = &converted;
+			}
+			drawOverlay(shown, overlay);
+			imshow(PREVIEW_WINDOW, *shown);
+		}
+		if (waitKey(1) >= 0) {
+			quit = true;
+		}
+	}
+	destroyAllWindows();
+}
@@ -0,0 +1,79 @@
+#ifndef PREVIEW_H
+#define PREVIEW_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <opencv2/opencv.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "trackHistory.h"
+
+using namespace cv;
+using namespace std;
+
+// only every PREVIEW_DECIMATION-th frame is offered to the preview
+#define PREVIEW_DECIMATION 3
+#define PREVIEW_WINDOW "drawing"
+// how often the window's events are pumped while no frame comes, ms
+#define PREVIEW_IDLE_MS 30
+
+// how a target was found, decides the marks drawn over it
+#define MARK_NONE 0
+#define MARK_FOUND 1	// large enough round blob
+#define MARK_CIRCLE 2	// small blob that passed the circle check
+#define MARK_SMALL 3	// small blob that did not
+
+// everything the detect stage used to draw over the frame
+typedef struct {
+	Point2f objectCenter;
+	float objectRadius;
+	int objectMark;
+	Point2f destCenter;
+	float destRadius;
+	int destMark;
+	TrackHistory history;
+	float angle;
+	float perspectiveAngle;
+} previewOverlay_t;
+
+// Shows the frames with their overlay on its own thread, so neither drawing
+// nor HighGUI is in the vision loop. The loop hands frames over through a one
+// frame slot that is overwritten when the renderer falls behind, so it never
+// waits for the display. Three buffers go round: the loop copies into filling
+// without the lock and only swaps it with the slot under it.
+class PreviewRenderer {
+	mutex lock;
+	condition_variable ready;
+	Mat filling;
+	Mat pending;
+	Mat drawing;
+	Mat converted;
+	previewOverlay_t pendingOverlay;
+	previewOverlay_t overlay;
+	bool fresh;
+	bool stopping;
+	atomic<bool> quit;
+	int every;
+	int frames;
+	thread worker;
+
+	void run();
+
+public:
+	PreviewRenderer(int every = PREVIEW_DECIMATION);
+	~PreviewRenderer();
+	void start();
+	void stop();
+	// the next submit is not decimated, so its overlay is worth filling in
+	bool wanted() const { return frames % every == 0; }
+	// copies the frame into the slot, skipped for decimated frames
+	void submit(const Mat &frame, const previewOverlay_t &overlay);
+	// a key was pressed in the window
+	bool quitRequested() const { return quit; }
+};
+
+void drawOverlay(Mat *frame, const previewOverlay_t &overlay);
+#endif
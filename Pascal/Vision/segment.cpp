@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "bitMask.h"
+#include "hsvThreshold.h"
+#include "colorLut.h"
+#include "segment.h"
+#include "../../Shared/trace.h"
+
+using namespace cv;
+using namespace std;
+
+// Top left part of a scratch image. The scratch only ever grows, so windows
+// that change size from frame to frame do not reallocate it.
+Mat scratchView(Mat *scratch, Size size, int type) {
+	if (scratch->type() != type || scratch->rows < size.height || scratch->cols < size.width) {
+		scratch->create(max(scratch->rows, size.height), max(scratch->cols, size.width), type);
+	}
+	return (*scratch)(Rect(0, 0, size.width, size.height));
+}
+
+// A CV_8UC2 YUYV image viewed as one CV_8UC4 Y0 U Y1 V pixel per pair. The view
+// keeps its place in the parent image, so filters still see the pixels around it.
+Mat yuyvPairs(const Mat &yuyv) {
+	Size whole;
+	Point offset;
+	yuyv.locateROI(whole, offset);
+	CV_Assert(offset.x % 2 == 0 && whole.width % 2 == 0 && yuyv.cols % 2 == 0);
+
+	Mat parent(whole.height, whole.width / 2, CV_8UC4, (void *)(yuyv.data - offset.y * yuyv.step - offset.x * 2), yuyv.step);
+	return parent(Rect(offset.x / 2, offset.y, yuyv.cols / 2, yuyv.rows));
+}
+
+// the pairs back as YUYV pixels
+Mat yuyvPixels(const Mat &pairs) {
+	return Mat(pairs.rows, pairs.cols * 2, CV_8UC2, pairs.data, pairs.step);
+}
+
+// Windows on a YUYV frame must not split a pair, so they are widened to even edges.
+Rect alignWindow(const Mat &frame, Rect window) {
+	if (frame.type() != CV_8UC2) {
+		return window;
+	}
+	int left = window.x & ~1;
+	int right = min((window.x + window.width + 1) & ~1, frame.cols);
+	return Rect(left, window.y, right - left, window.height);
+}
+
+// A separable kernel in 8 bit fixed point, its weights add up to 256
+typedef struct {
+	int radius;
+	int weights[2 * BLUR_MAX_RADIUS + 1];
+} blurKernel_t;
+
+// The kernel GaussianBlur takes for an odd size and sigma 0: its own table for
+// 5 taps, otherwise sigma 0.3 * ((size - 1) / 2 - 1) + 0.8. The centre weight
+// takes the rounding, so a flat image stays flat.
+static void gaussianKernel(int size, blurKernel_t *kernel) {
+	CV_Assert(size % 2 == 1 && size / 2 <= BLUR_MAX_RADIUS);
+	int radius = size / 2;
+	kernel->radius = radius;
+	if (size == 5) {
+		static const int table[5] = {16, 64, 96, 64, 16};
+		copy(table, table + 5, kernel->weights);
+		return;
+	}
+
+	double sigma = 0.3 * ((size - 1) * 0.5 - 1) + 0.8;
+	double gauss[2 * BLUR_MAX_RADIUS + 1];
+	double sum = 0;
+	for (int i = 0; i < size; i++) {
+		gauss[i] = exp(-(i - radius) * (i - radius) / (2 * sigma * sigma));
+		sum += gauss[i];
+	}
+	int total = 0;
+	for (int i = 0; i < size; i++) {
+		if (i != radius) {
+			kernel->weights[i] = cvRound(256 * gauss[i] / sum);
+			total += kernel->weights[i];
+		}
+	}
+	kernel->weights[radius] = 256 - total;
+}
+
+// BORDER_REFLECT_101, the border OpenCV's filters use by default
+static inline int reflect101(int i, int n) {
+	if (n == 1) {
+		return 0;
+	}
+	while (i < 0 || i >= n) {
+		i = i < 0 ? -i : 2 * n - 2 - i;
+	}
+	return i;
+}
+
+// Smooths src with kx along its rows and ky down its columns, keeping every
+// stride-th pixel each way, into dst. Pixels past the edges of src are read
+// from the image it is a view of and mirrored at that image's edges, so a
+// window comes out as the same part of a full frame pass. The row pass keeps
+// 16 bit sums in blur->rows, the column pass 32 bit ones in blur->sums for the
+// columns SSE2 does not cover, both only ever grow.
+static void separableFilter(const Mat &src, Mat *dst, const blurKernel_t &kx, const blurKernel_t &ky, int stride,
+							blurWorkspace_t *blur) {
+	int cn = src.channels();
+	Size whole;
+	Point offset;
+	src.locateROI(whole, offset);
+	int dstCols = (src.cols + stride - 1) / stride;
+	int dstRows = (src.rows + stride - 1) / stride;
+	int width = dstCols * cn;
+	int numRows = (dstRows - 1) * stride + 2 * ky.radius + 1;
+	dst->create(dstRows, dstCols, src.type());
+	Mat rows = scratchView(&blur->rows, Size(width, numRows), CV_16UC1);
+	Mat sums = scratchView(&blur->sums, Size(width, 1), CV_32SC1);
+
+	// columns whose taps all fall inside the whole image
+	int inFirst = min(max((kx.radius - offset.x + stride - 1) / stride, 0), dstCols);
+	int inLast = max(min((whole.width - offset.x - kx.radius + stride - 1) / stride, dstCols), inFirst);
+
+#if defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	__m128i wx[BLUR_MAX_RADIUS + 1];
+	__m128i wy[2 * BLUR_MAX_RADIUS + 1];
+	for (int k = 0; k <= kx.radius; k++) {
+		wx[k] = _mm_set1_epi16(kx.weights[kx.radius + k]);
+	}
+	for (int k = 0; k <= 2 * ky.radius; k++) {
+		wy[k] = _mm_set1_epi16(ky.weights[k]);
+	}
+#endif
+
+	for (int r = 0; r < numRows; r++) {
+		int y = reflect101(offset.y + r - ky.radius, whole.height) - offset.y;
+		const uchar *s = src.data + (ptrdiff_t)y * (ptrdiff_t)src.step;
+		ushort *d = rows.ptr<ushort>(r);
+
+		// columns whose taps are all inside the image read them directly, the sums fit 16 bits
+		if (stride == 1) {
+			int i = inFirst * cn;
+#if defined(__SSE2__)
+			// the kernel is symmetric, so mirrored taps are added before they are weighted
+			for (; i + 8 <= inLast * cn; i += 8) {
+				__m128i sum = _mm_mullo_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(s + i)), zero), wx[0]);
+				for (int k = 1; k <= kx.radius; k++) {
+					__m128i left = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(s + i - k * cn)), zero);
+					__m128i right = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(s + i + k * cn)), zero);
+					sum = _mm_add_epi16(sum, _mm_mullo_epi16(_mm_add_epi16(left, right), wx[k]));
+				}
+				_mm_storeu_si128((__m128i *)(d + i), sum);
+			}
+#endif
+			for (; i < inLast * cn; i++) {
+				int sum = 0;
+				for (int k = -kx.radius; k <= kx.radius; k++) {
+					sum += kx.weights[k + kx.radius] * s[i + k * cn];
+				}
+				d[i] = sum;
+			}
+		} else {
+			for (int x = inFirst; x < inLast; x++) {
+				const uchar *p = s + x * stride * cn;
+				for (int c = 0; c < cn; c++) {
+					int sum = 0;
+					for (int k = -kx.radius; k <= kx.radius; k++) {
+						sum += kx.weights[k + kx.radius] * p[k * cn + c];
+					}
+					d[x * cn + c] = sum;
+				}
+			}
+		}
+
+		// and the few near the edges mirror theirs
+		for (int x = 0; x < dstCols; x++) {
+			if (x >= inFirst && x < inLast) {
+				x = inLast - 1;
+				continue;
+			}
+			int cx = x * stride;
+			for (int c = 0; c < cn; c++) {
+				int sum = 0;
+				for (int k = -kx.radius; k <= kx.radius; k++) {
+					int sx = reflect101(offset.x + cx + k, whole.width) - offset.x;
+					sum += kx.weights[k + kx.radius] * s[sx * cn + c];
+				}
+				d[x * cn + c] = sum;
+			}
+		}
+	}
+
+	uint32_t *acc = sums.ptr<uint32_t>(0);
+	const ushort *taps[2 * BLUR_MAX_RADIUS + 1];
+	for (int y = 0; y < dstRows; y++) {
+		uchar *out = dst->ptr<uchar>(y);
+		for (int k = 0; k <= 2 * ky.radius; k++) {
+			taps[k] = rows.ptr<ushort>(y * stride + k);
+		}
+		int i = 0;
+#if defined(__SSE2__)
+		// 16 x 16 bit products as 32 bit, 8 columns at a time
+		const __m128i round = _mm_set1_epi32(1 << 15);
+		for (; i + 8 <= width; i += 8) {
+			__m128i lo = round;
+			__m128i hi = round;
+			for (int k = 0; k <= 2 * ky.radius; k++) {
+				__m128i h = _mm_loadu_si128((const __m128i *)(taps[k] + i));
+				__m128i productLo = _mm_mullo_epi16(h, wy[k]);
+				__m128i productHi = _mm_mulhi_epu16(h, wy[k]);
+				lo = _mm_add_epi32(lo, _mm_unpacklo_epi16(productLo, productHi));
+				hi = _mm_add_epi32(hi, _mm_unpackhi_epi16(productLo, productHi));
+			}
+			__m128i packed = _mm_packs_epi32(_mm_srli_epi32(lo, 16), _mm_srli_epi32(hi, 16));
+			_mm_storel_epi64((__m128i *)(out + i), _mm_packus_epi16(packed, packed));
+		}
+#endif
+		for (int j = i; j < width; j++) {
+			acc[j] = ky.weights[0] * taps[0][j];
+		}
+		for (int k = 1; k <= 2 * ky.radius; k++) {
+			uint32_t w = ky.weights[k];
+			for (int j = i; j < width; j++) {
+				acc[j] += w * taps[k][j];
+			}
+		}
+		for (int j = i; j < width; j++) {
+			out[j] = (acc[j] + (1 << 15)) >> 16;
+		}
+	}
+}
+
+// Gaussian blur of the segmentation into blur->image, returns the blurred
+// view. A YUYV frame is blurred pair by pair, so luma is only mixed with luma
+// and U with U. Pairs are two pixels wide, hence half the kernel width for
+// about the same spread.
+Mat blurFrame(const Mat &frame, blurWorkspace_t *blur) {
+	TRACE_SCOPE("blur");
+	Mat blurred = scratchView(&blur->image, frame.size(), frame.type());
+	blurKernel_t kx;
+	blurKernel_t ky;
+	gaussianKernel(11, &ky);
+
+	if (frame.type() == CV_8UC2) {
+		gaussianKernel(5, &kx);
+		Mat out(blurred.rows, blurred.cols / 2, CV_8UC4, blurred.data, blurred.step);
+		separableFilter(yuyvPairs(frame), &out, kx, ky, 1, blur);
+	} else {
+		separableFilter(frame, &blurred, ky, ky, 1, blur);
+	}
+	return blurred;
+}
+
+// pyrDown's 1 4 6 4 1 smoothing and halving, exact to it, without its
+// allocations. Odd sizes round up like pyrDown.
+void pyramidDown(const Mat &src, Mat *dst, blurWorkspace_t *blur) {
+	blurKernel_t kernel;
+	gaussianKernel(5, &kernel);
+	separableFilter(src, dst, kernel, kernel, 2, blur);
+}
+
+// blurs the frame once, then thresholds every target straight from the blurred
+// BGR or YUYV pixels into bit packed masks in a single traversal. blur is scratch space
+// kept between frames.
+void segmentFrame(Mat *frame, const colorTargets_t &targets, vector<BitMask> *masks, blurWorkspace_t *blur) {
+	Mat blurred = blurFrame(*frame, blur);
+	TRACE_SCOPE("hsv");
+	thresholdTargets(blurred, targets, masks);
+}
+
+// segments each target only inside its own window, mask t covers windows[t].
+// Falls back to one shared pass when every window is the same.
+void segmentWindows(Mat *frame, const colorTargets_t &targets, const vector<Rect> &windows, vector<BitMask> *masks, blurWorkspace_t *blur) {
+	int numTargets = targets.ranges.size();
+	bool shared = true;
+
+	for (int t = 1; t < numTargets; t++) {
+		shared = shared && windows[t] == windows[0];
+	}
+	if (shared) {
+		Mat roi = (*frame)(windows[0]);
+		segmentFrame(&roi, targets, masks, blur);
+		return;
+	}
+
+	masks->resize(numTargets);
+	for (int t = 0; t < numTargets; t++) {
+		BitMask *mask = &(*masks)[t];
+		// a window blurs with the real pixels around it, so edges match the full frame
+		Mat blurred = blurFrame((*frame)(windows[t]), blur);
+		TRACE_SCOPE("hsv");
+		thresholdTarget(blurred, targets, t, mask);
+	}
+}
+
+// morphological opening then closing with a 5x5 ellipse, done on 64 pixels at a time
+void cleanMask(BitMask *mask, BitMask *temp) {
+	TRACE_SCOPE("morphology");
+
+	// morphological opening (removes small objects from the foreground)
+	openMask(mask, temp);
+
+	// morphological closing (removes small holes from the foreground)
+	closeMask(mask, temp);
+}
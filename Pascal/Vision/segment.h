@@ -0,0 +1,34 @@
+#ifndef SEGMENT_H
+#define SEGMENT_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "bitMask.h"
+#include "hsvThreshold.h"
+#include "colorLut.h"
+
+using namespace cv;
+using namespace std;
+
+// widest blur kernel, 11 taps
+#define BLUR_MAX_RADIUS 5
+
+// scratch of the blur and pyramid filters, they stop allocating once it has grown
+typedef struct {
+	Mat image;
+	Mat rows;
+	Mat sums;
+} blurWorkspace_t;
+
+Mat scratchView(Mat *scratch, Size size, int type);
+Mat yuyvPairs(const Mat &yuyv);
+Mat yuyvPixels(const Mat &pairs);
+Rect alignWindow(const Mat &frame, Rect window);
+Mat blurFrame(const Mat &frame, blurWorkspace_t *blur);
+void pyramidDown(const Mat &src, Mat *dst, blurWorkspace_t *blur);
+void segmentFrame(Mat *frame, const colorTargets_t &targets, vector<BitMask> *masks, blurWorkspace_t *blur);
+void segmentWindows(Mat *frame, const colorTargets_t &targets, const vector<Rect> &windows, vector<BitMask> *masks, blurWorkspace_t *blur);
+void cleanMask(BitMask *mask, BitMask *temp);
+#endif
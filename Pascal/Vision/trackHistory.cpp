@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <opencv2/opencv.hpp>
+#include "trackHistory.h"
+
+using namespace cv;
+using namespace std;
+
+TrackHistory::TrackHistory() {
+	clear();
+}
+
+void TrackHistory::clear() {
+	oldest = 0;
+	count = 0;
+	resum();
+}
+
+void TrackHistory::resum() {
+	sumX = sumY = sumR = 0;
+	sumXX = sumYY = sumRR = 0;
+	for (int i = 0; i < count; i++) {
+		Point2f c = center(i);
+		float r = radius(i);
+		sumX += c.x;
+		sumY += c.y;
+		sumR += r;
+		sumXX += (double)c.x * c.x;
+		sumYY += (double)c.y * c.y;
+		sumRR += (double)r * r;
+	}
+}
+
+void TrackHistory::push(Point2f center, float radius) {
+	int slot = (oldest + count) % TRACK_HISTORY_SIZE;
+
+	if (count == TRACK_HISTORY_SIZE) {
+		// the slot holds the oldest sample, take it out of the sums first
+		Point2f c = centers[slot];
+		float r = radii[slot];
+		sumX -= c.x;
+		sumY -= c.y;
+		sumR -= r;
+		sumXX -= (double)c.x * c.x;
+		sumYY -= (double)c.y * c.y;
+		sumRR -= (double)r * r;
+		oldest = (oldest + 1) % TRACK_HISTORY_SIZE;
+		count--;
+	}
+
+	centers[slot] = center;
+	radii[slot] = radius;
+	count++;
+	sumX += center.x;
+	sumY += center.y;
+	sumR += radius;
+	sumXX += (double)center.x * center.x;
+	sumYY += (double)center.y * center.y;
+	sumRR += (double)radius * radius;
+
+	if (oldest == 0 && count == TRACK_HISTORY_SIZE) {
+		resum();
+	}
+}
+
+Point2f TrackHistory::meanCenter() const {
+	if (count == 0) {
+		return Point2f();
+	}
+	return Point2f(sumX / count, sumY / count);
+}
+
+float TrackHistory::meanRadius() const {
+	if (count == 0) {
+		return 0;
+	}
+	return sumR / count;
+}
+
+Point2f TrackHistory::centerVariance() const {
+	if (count == 0) {
+		return Point2f();
+	}
+	double meanX = sumX / count;
+	double meanY = sumY / count;
+	return Point2f(max(sumXX / count - meanX * meanX, 0.0), max(sumYY / count - meanY * meanY, 0.0));
+}
+
+float TrackHistory::radiusVariance() const {
+	if (count == 0) {
+		return 0;
+	}
+	double mean = sumR / count;
+	return max(sumRR / count - mean * mean, 0.0);
+}
+
+Point2f TrackHistory::velocity(int frames) const {
+	frames = min(frames, count - 1);
+	if (frames <= 0) {
+		return Point2f();
+	}
+	Point2f moved = newest() - back(frames);
+	return Point2f(moved.x / frames, moved.y / frames);
+}
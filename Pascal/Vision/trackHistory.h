@@ -0,0 +1,46 @@
+#ifndef TRACKHISTORY_H
+#define TRACKHISTORY_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <opencv2/opencv.hpp>
+
+using namespace cv;
+using namespace std;
+
+#define TRACK_HISTORY_SIZE 32
+
+// Last TRACK_HISTORY_SIZE centres and radii of a target in a fixed ring. The
+// running sums make the mean and variance O(1), they are recomputed from the
+// samples every time the ring wraps so rounding errors cannot build up.
+class TrackHistory {
+	Point2f centers[TRACK_HISTORY_SIZE];
+	float radii[TRACK_HISTORY_SIZE];
+	int oldest;
+	int count;
+	double sumX, sumY, sumR;
+	double sumXX, sumYY, sumRR;
+
+	void resum();
+
+public:
+	TrackHistory();
+	void clear();
+	// adds the newest sample, dropping the oldest once full
+	void push(Point2f center, float radius);
+	int size() const { return count; }
+	bool empty() const { return count == 0; }
+	// sample i, 0 is the oldest and size() - 1 the newest
+	Point2f center(int i) const { return centers[(oldest + i) % TRACK_HISTORY_SIZE]; }
+	float radius(int i) const { return radii[(oldest + i) % TRACK_HISTORY_SIZE]; }
+	// the centre from the given number of frames before the newest
+	Point2f back(int frames) const { return center(count - 1 - frames); }
+	Point2f newest() const { return back(0); }
+	Point2f meanCenter() const;
+	float meanRadius() const;
+	// per axis variance of the centre
+	Point2f centerVariance() const;
+	float radiusVariance() const;
+	// average motion per frame over the last frames, 0 without enough samples
+	Point2f velocity(int frames) const;
+};
+#endif
@@ -0,0 +1,306 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/videodev2.h>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include "v4l2Capture.h"
+
+using namespace cv;
+using namespace std;
+
+// ioctl that retries when interrupted by a signal
+static int xioctl(int fd, unsigned long request, void *arg) {
+	int r;
+	do {
+		r = ioctl(fd, request, arg);
+	} while (r < 0 && errno == EINTR);
+	return r;
+}
+
+int64_t monotonicUs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Mat header over a raw buffer in the given format, no pixels are copied
+static Mat viewBuffer(void *start, size_t used, int width, int height, int stride, uint32_t fourcc) {
+	switch (fourcc) {
+		case V4L2_PIX_FMT_YUYV:
+			return Mat(height, width, CV_8UC2, start, stride);
+		case V4L2_PIX_FMT_BGR24:
+			return Mat(height, width, CV_8UC3, start, stride);
+		case V4L2_PIX_FMT_GREY:
+			return Mat(height, width, CV_8UC1, start, stride);
+		default:
+			// compressed formats such as MJPEG are a byte string
+			return Mat(1, (int)used, CV_8UC1, start);
+	}
+}
+
+// Converts a captured frame to the BGR the pipeline works on. BGR frames are
+// passed through as the same view, YUYV and MJPEG take their one conversion.
+void frameToBGR(const captureFrame_t &frame, Mat *bgr) {
+	switch (frame.fourcc) {
+		case V4L2_PIX_FMT_BGR24:
+			*bgr = frame.image;
+			break;
+		case V4L2_PIX_FMT_YUYV:
+			cvtColor(frame.image, *bgr, COLOR_YUV2BGR_YUYV);
+			break;
+		case V4L2_PIX_FMT_GREY:
+			cvtColor(frame.image, *bgr, COLOR_GRAY2BGR);
+			break;
+		default:
+			imdecode(frame.image, IMREAD_COLOR, bgr);
+			break;
+	}
+}
+
+V4L2Capture::V4L2Capture() : fd(-1), width(0), height(0), stride(0), fourcc(0) {
+}
+
+V4L2Capture::~V4L2Capture() {
+	close();
+}
+
+bool V4L2Capture::open(const char *device, int width, int height, uint32_t fourcc) {
+	struct v4l2_capability cap;
+	struct v4l2_format fmt;
+	struct v4l2_requestbuffers req;
+
+	fd = ::open(device, O_RDWR);
+	if (fd < 0) {
+		cout << "Error opening " << device << ": " << strerror(errno) << endl;
+		return false;
+	}
+
+	memset(&cap, 0, sizeof(cap));
+	if (xioctl(fd, VIDIOC_QUERYCAP, &cap) < 0 ||
+		!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE) || !(cap.capabilities & V4L2_CAP_STREAMING)) {
+		cout << "Error: " << device << " is not a streaming capture device" << endl;
+		close();
+		return false;
+	}
+
+	memset(&fmt, 0, sizeof(fmt));
+	fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	fmt.fmt.pix.width = width;
+	fmt.fmt.pix.height = height;
+	fmt.fmt.pix.pixelformat = fourcc;
+	fmt.fmt.pix.field = V4L2_FIELD_NONE;
+	if (xioctl(fd, VIDIOC_S_FMT, &fmt) < 0) {
+		cout << "Error setting capture format: " << strerror(errno) << endl;
+		close();
+		return false;
+	}
+
+	// the driver may have picked the closest size or format it supports
+	this->width = fmt.fmt.pix.width;
+	this->height = fmt.fmt.pix.height;
+	this->stride = fmt.fmt.pix.bytesperline;
+	this->fourcc = fmt.fmt.pix.pixelformat;
+
+	memset(&req, 0, sizeof(req));
+	req.count = CAPTURE_BUFFERS;
+	req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	req.memory = V4L2_MEMORY_MMAP;
+	if (xioctl(fd, VIDIOC_REQBUFS, &req) < 0 || req.count < 2) {
+		cout << "Error requesting capture buffers: " << strerror(errno) << endl;
+		close();
+		return false;
+	}
+
+	for (unsigned i = 0; i < req.count; i++) {
+		struct v4l2_buffer buf;
+		memset(&buf, 0, sizeof(buf));
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		buf.index = i;
+		if (xioctl(fd, VIDIOC_QUERYBUF, &buf) < 0) {
+			cout << "Error querying capture buffer " << i << endl;
+			close();
+			return false;
+		}
+
+		void *start = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buf.m.offset);
+		if (start == MAP_FAILED) {
+			cout << "Error mapping capture buffer " << i << endl;
+			close();
+			return false;
+		}
+		buffers.push_back(start);
+		lengths.push_back(buf.length);
+
+		if (xioctl(fd, VIDIOC_QBUF, &buf) < 0) {
+			cout << "Error queueing capture buffer " << i << endl;
+			close();
+			return false;
+		}
+	}
+
+	enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	if (xioctl(fd, VIDIOC_STREAMON, &type) < 0) {
+		cout << "Error starting capture stream: " << strerror(errno) << endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool V4L2Capture::setControl(uint32_t id, int value) {
+	struct v4l2_control control;
+	control.id = id;
+	control.value = value;
+	return xioctl(fd, VIDIOC_S_CTRL, &control) == 0;
+}
+
+// blocks until the driver fills a buffer and hands out a view of it
+bool V4L2Capture::grab(captureFrame_t *frame) {
+	struct v4l2_buffer buf;
+
+	memset(&buf, 0, sizeof(buf));
+	buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	buf.memory = V4L2_MEMORY_MMAP;
+	if (fd < 0 || xioctl(fd, VIDIOC_DQBUF, &buf) < 0) {
+		frame->index = -1;
+		return false;
+	}
+
+	frame->image = viewBuffer(buffers[buf.index], buf.bytesused, width, height, stride, fourcc);
+	frame->index = buf.index;
+	frame->fourcc = fourcc;
+	frame->sequence = buf.sequence;
+	frame->timestampUs = (int64_t)buf.timestamp.tv_sec * 1000000 + buf.timestamp.tv_usec;
+	return true;
+}
+
+// gives the buffer back to the driver, the frame's view must not be used after
+void V4L2Capture::release(captureFrame_t *frame) {
+	if (frame->index < 0) {
+		return;
+	}
+
+	struct v4l2_buffer buf;
+	memset(&buf, 0, sizeof(buf));
+	buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	buf.memory = V4L2_MEMORY_MMAP;
+	buf.index = frame->index;
+	xioctl(fd, VIDIOC_QBUF, &buf);
+
+	frame->image = Mat();
+	frame->index = -1;
+}
+
+void V4L2Capture::close() {
+	if (fd < 0) {
+		return;
+	}
+
+	enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	xioctl(fd, VIDIOC_STREAMOFF, &type);
+	for (int i = 0; i < buffers.size(); i++) {
+		munmap(buffers[i], lengths[i]);
+	}
+	buffers.clear();
+	lengths.clear();
+	::close(fd);
+	fd = -1;
+}
+
+FileCapture::FileCapture() : fd(-1), data(NULL), size(0), frameSize(0), next(0),
+							 width(0), height(0), fourcc(0), startUs(0), fps(30) {
+}
+
+FileCapture::~FileCapture() {
+	close();
+}
+
+bool FileCapture::open(const char *path, int width, int height, uint32_t fourcc, double fps) {
+	struct stat st;
+
+	fd = ::open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		cout << "Error opening " << path << ": " << strerror(errno) << endl;
+		close();
+		return false;
+	}
+
+	this->width = width;
+	this->height = height;
+	this->fourcc = fourcc;
+	this->fps = fps;
+	switch (fourcc) {
+		case V4L2_PIX_FMT_YUYV:
+			frameSize = (size_t)width * height * 2;
+			break;
+		case V4L2_PIX_FMT_BGR24:
+			frameSize = (size_t)width * height * 3;
+			break;
+		case V4L2_PIX_FMT_GREY:
+			frameSize = (size_t)width * height;
+			break;
+		default:
+			cout << "Error: raw files must hold YUYV, BGR24 or GREY frames" << endl;
+			close();
+			return false;
+	}
+
+	size = st.st_size;
+	if (size < frameSize) {
+		cout << "Error: " << path << " holds no complete frame" << endl;
+		close();
+		return false;
+	}
+
+	// private so the pipeline can draw on BGR frames without touching the file
+	void *start = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (start == MAP_FAILED) {
+		cout << "Error mapping " << path << endl;
+		close();
+		return false;
+	}
+	data = (uchar *)start;
+	next = 0;
+	startUs = monotonicUs();
+	return true;
+}
+
+bool FileCapture::grab(captureFrame_t *frame) {
+	if (data == NULL || (next + 1) * frameSize > size) {
+		frame->index = -1;
+		return false;
+	}
+
+	frame->image = viewBuffer(data + next * frameSize, frameSize, width, height, 0, fourcc);
+	frame->index = next;
+	frame->fourcc = fourcc;
+	frame->sequence = next;
+	frame->timestampUs = startUs + (int64_t)(next * 1000000 / fps);
+	next++;
+	return true;
+}
+
+void FileCapture::release(captureFrame_t *frame) {
+	frame->image = Mat();
+	frame->index = -1;
+}
+
+void FileCapture::close() {
+	if (data != NULL) {
+		munmap(data, size);
+		data = NULL;
+	}
+	if (fd >= 0) {
+		::close(fd);
+		fd = -1;
+	}
+}
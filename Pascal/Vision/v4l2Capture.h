@@ -0,0 +1,81 @@
+#ifndef V4L2CAPTURE_H
+#define V4L2CAPTURE_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <linux/videodev2.h>
+#include <opencv2/opencv.hpp>
+
+using namespace cv;
+using namespace std;
+
+#define CAPTURE_BUFFERS 4
+#define CAPTURE_WIDTH 640
+#define CAPTURE_HEIGHT 480
+
+// One captured frame. image is a view of the capture buffer, not a copy, and is
+// only valid until the frame is released back to its source.
+typedef struct {
+	Mat image;
+	int index;
+	uint32_t fourcc;
+	uint32_t sequence;
+	int64_t timestampUs;	// capture time on CLOCK_MONOTONIC
+} captureFrame_t;
+
+// something frames can be grabbed from, a camera or a recording
+class FrameSource {
+public:
+	virtual ~FrameSource() {}
+	virtual bool grab(captureFrame_t *frame) = 0;
+	virtual void release(captureFrame_t *frame) = 0;
+	virtual void close() = 0;
+};
+
+// camera on V4L2 mmap streaming buffers, frames are views of the driver's buffers
+class V4L2Capture : public FrameSource {
+	int fd;
+	int width;
+	int height;
+	int stride;
+	uint32_t fourcc;
+	vector<void *> buffers;
+	vector<size_t> lengths;
+
+public:
+	V4L2Capture();
+	~V4L2Capture();
+	bool open(const char *device, int width, int height, uint32_t fourcc = V4L2_PIX_FMT_YUYV);
+	bool setControl(uint32_t id, int value);
+	bool grab(captureFrame_t *frame);
+	void release(captureFrame_t *frame);
+	void close();
+};
+
+// File backed stand-in for a camera: raw frames of one format stored back to
+// back, mmap'd and handed out in order with timestamps spaced at fps
+class FileCapture : public FrameSource {
+	int fd;
+	uchar *data;
+	size_t size;
+	size_t frameSize;
+	size_t next;
+	int width;
+	int height;
+	uint32_t fourcc;
+	int64_t startUs;
+	double fps;
+
+public:
+	FileCapture();
+	~FileCapture();
+	bool open(const char *path, int width, int height, uint32_t fourcc = V4L2_PIX_FMT_YUYV, double fps = 30);
+	bool grab(captureFrame_t *frame);
+	void release(captureFrame_t *frame);
+	void close();
+};
+
+int64_t monotonicUs();
+void frameToBGR(const captureFrame_t &frame, Mat *bgr);
+#endif
@@ -0,0 +1,74 @@
+// Binary frames from Pascal to Maxwell, shared by both boards.
+// Every frame is PROTOCOL_FRAME_SIZE bytes, little endian whatever the host:
+//   0  magic    uint16  PROTOCOL_MAGIC
+//   2  version  uint8   PROTOCOL_VERSION
+//   3  op       uint8   protocolOp_t
+//   4  seq      uint32  counts every frame sent, heartbeats included
+//   8  value    float   cm for a drive, degrees for a turn
+//   12 speed    float   fraction of full speed
+//   16 sentUs   uint64  CLOCK_REALTIME when sent, us
+//   24 crc      uint16  CRC-16/CCITT-FALSE of bytes 0 to 23
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+#define PROTOCOL_MAGIC 0xB8B8
+#define PROTOCOL_VERSION 1
+#define PROTOCOL_FRAME_SIZE 26
+// Pascal sends a heartbeat after this long without a command, Maxwell stops
+// the motors once after PROTOCOL_LINK_TIMEOUT_MS without any frame
+#define PROTOCOL_HEARTBEAT_MS 250
+#define PROTOCOL_LINK_TIMEOUT_MS 1000
+
+// the same numbers as Pascal's motorOp_t, with the heartbeat after them
+typedef enum {
+	PROTOCOL_NONE = 0,
+	PROTOCOL_DRIVE,
+	PROTOCOL_TURN,
+	PROTOCOL_STOP,
+	PROTOCOL_EXIT,
+	PROTOCOL_HEARTBEAT,
+	PROTOCOL_OPS
+} protocolOp_t;
+
+// what decodeFrame found wrong, PROTOCOL_OK for a frame to act on
+typedef enum {
+	PROTOCOL_OK = 0,
+	PROTOCOL_SHORT,
+	PROTOCOL_BAD_MAGIC,
+	PROTOCOL_BAD_VERSION,
+	PROTOCOL_BAD_CRC,
+	PROTOCOL_BAD_OP,
+	PROTOCOL_BAD_NUMBER
+} protocolError_t;
+
+typedef struct {
+	uint8_t op;
+	uint32_t seq;
+	float value;
+	float speed;
+	uint64_t sentUs;
+} protocolFrame_t;
+
+static inline uint64_t protocolNowUs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+uint16_t protocolCrc(const uint8_t *data, size_t size);
+// writes exactly PROTOCOL_FRAME_SIZE bytes to out
+void encodeFrame(const protocolFrame_t *frame, uint8_t *out);
+// Reads at most size bytes of data, nothing is trusted before the checks pass.
+// Only a frame with PROTOCOL_OK is written to frame.
+protocolError_t decodeFrame(const uint8_t *data, size_t size, protocolFrame_t *frame);
+// "drive", "heartbeat" and so on, "" for PROTOCOL_NONE and unknown ops
+const char *protocolOpName(uint8_t op);
+// PROTOCOL_OPS for a word that is not an op
+protocolOp_t protocolOpFromName(const char *name);
+const char *protocolErrorName(protocolError_t error);
+#endif
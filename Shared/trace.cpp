@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <atomic>
+#include "trace.h"
+
+using namespace std;
+
+typedef struct traceRing {
+	traceEvent_t events[TRACE_RING_SIZE];
+	// written only by the owning thread, read by the dump
+	atomic<uint64_t> head;
+	int tid;
+	char name[TRACE_NAME_SIZE];
+	struct traceRing *next;
+} traceRing_t;
+
+// every ring ever made, they outlive their threads so the dump still sees them
+static atomic<traceRing_t *> rings(NULL);
+static __thread traceRing_t *localRing = NULL;
+
+// first event of a thread, links a new ring into the list without a lock
+static traceRing_t *makeRing() {
+	traceRing_t *ring = new traceRing_t;
+	ring->head.store(0, memory_order_relaxed);
+	ring->tid = (int)syscall(SYS_gettid);
+	snprintf(ring->name, TRACE_NAME_SIZE, "thread %d", ring->tid);
+
+	traceRing_t *first = rings.load(memory_order_relaxed);
+	do {
+		ring->next = first;
+	} while (!rings.compare_exchange_weak(first, ring, memory_order_release, memory_order_relaxed));
+	return ring;
+}
+
+void traceRecord(const char *name, uint64_t startNs, uint64_t endNs) {
+	traceRing_t *ring = localRing;
+	if (ring == NULL) {
+		ring = localRing = makeRing();
+	}
+
+	uint64_t head = ring->head.load(memory_order_relaxed);
+	traceEvent_t *event = &ring->events[head & (TRACE_RING_SIZE - 1)];
+	event->name = name;
+	event->startNs = startNs;
+	event->durationNs = endNs - startNs;
+	ring->head.store(head + 1, memory_order_release);
+}
+
+void traceThreadName(const char *name) {
+	if (localRing == NULL) {
+		localRing = makeRing();
+	}
+	strncpy(localRing->name, name, TRACE_NAME_SIZE - 1);
+	localRing->name[TRACE_NAME_SIZE - 1] = '\0';
+}
+
+bool traceDump(const char *path) {
+	FILE *file = fopen(path, "w");
+	if (file == NULL) {
+		perror("trace dump");
+		return false;
+	}
+
+	int pid = getpid();
+	bool first = true;
+	fprintf(file, "{\"traceEvents\":[\n");
+	for (traceRing_t *ring = rings.load(memory_order_acquire); ring != NULL; ring = ring->next) {
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+				first ? "" : ",\n", pid, ring->tid, ring->name);
+		first = false;
+
+		// a thread still recording may overwrite the oldest events while they are written out
+		uint64_t head = ring->head.load(memory_order_acquire);
+		uint64_t oldest = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+		for (uint64_t i = oldest; i < head; i++) {
+			const traceEvent_t *event = &ring->events[i & (TRACE_RING_SIZE - 1)];
+			// Chrome wants microseconds
+			fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+					event->name, pid, ring->tid, event->startNs / 1000.0, event->durationNs / 1000.0);
+		}
+	}
+	fprintf(file, "\n]}\n");
+	return fclose(file) == 0;
+}
@@ -0,0 +1,53 @@
+// Scoped tracepoints shared by Pascal and Maxwell.
+// Each thread records into its own ring, so recording takes no lock and costs
+// two clock reads and a store. The rings can be dumped as Chrome trace JSON
+// (chrome://tracing or ui.perfetto.dev).
+#ifndef TRACE_H
+#define TRACE_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+// events kept per thread, the oldest are overwritten, must be a power of two
+#define TRACE_RING_SIZE 8192
+#define TRACE_NAME_SIZE 16
+
+// one complete span, name must be a string literal or otherwise outlive the trace
+typedef struct {
+	const char *name;
+	uint64_t startNs;
+	uint64_t durationNs;
+} traceEvent_t;
+
+static inline uint64_t traceNowNs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void traceRecord(const char *name, uint64_t startNs, uint64_t endNs);
+// names the calling thread in the dump
+void traceThreadName(const char *name);
+// writes every thread's recorded events, best taken once the threads are quiet
+bool traceDump(const char *path);
+
+// records the time until the end of the enclosing scope
+class TraceScope {
+	const char *name;
+	uint64_t start;
+
+public:
+	TraceScope(const char *name) : name(name), start(traceNowNs()) {}
+	~TraceScope() { traceRecord(name, start, traceNowNs()); }
+};
+
+// build with -DDISABLE_TRACE to compile the tracepoints out
+#ifdef DISABLE_TRACE
+#define TRACE_SCOPE(name)
+#else
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#endif
+#endif
@@ -0,0 +1,5 @@
+#! /bin/sh
+
+echo -n "g++ compiles protocolFuzz.cpp.."
+g++ -Wall -g -O2 -std=c++11 -fsanitize=address,undefined protocolFuzz.cpp ../../Shared/protocol.cpp -o protocolFuzz
+echo "Done!"
@@ -0,0 +1,160 @@
+// Fuzzes decodeFrame in Shared/protocol.cpp and times it against the old text packets.
+// Build with compile.sh, which turns on AddressSanitizer so any read past the
+// buffer given to decodeFrame stops the run. Built with -DPROTOCOL_LIBFUZZER
+// the same checks run under libFuzzer instead of the random loop.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "../../Shared/protocol.h"
+
+using namespace std;
+
+#define FUZZ_ROUNDS 2000000
+#define FUZZ_MAX_SIZE 64
+#define TIMING_ROUNDS 1000000
+
+static int failures = 0;
+
+static void fail(const char *what, const uint8_t *data, size_t size) {
+	printf("FAIL %s:", what);
+	for (size_t i = 0; i < size; i++) {
+		printf(" %02x", data[i]);
+	}
+	printf("\n");
+	failures++;
+}
+
+// whatever the bytes, a frame decodeFrame accepts has to be safe to act on
+static void checkDecode(const uint8_t *data, size_t size) {
+	protocolFrame_t frame;
+	protocolError_t result = decodeFrame(data, size, &frame);
+	if (result > PROTOCOL_BAD_NUMBER) {
+		fail("unknown result", data, size);
+	}
+	if (result == PROTOCOL_OK) {
+		if (size < PROTOCOL_FRAME_SIZE || frame.op >= PROTOCOL_OPS || !isfinite(frame.value) || !isfinite(frame.speed)) {
+			fail("accepted a bad frame", data, size);
+		}
+	}
+}
+
+#ifdef PROTOCOL_LIBFUZZER
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+	checkDecode(data, size);
+	return 0;
+}
+#else
+
+// the old text packet parse from receive.c, for timing only
+static void getString(const char *packet, char data[], int *index) {
+	int i = 0;
+	while (packet[*index] != '*') {
+		data[i] = packet[(*index)++];
+		i++;
+	}
+	data[i] = '\0';
+	*index += 4;
+	if (data[0] == '\0') {
+		memcpy(data, "error", 6);
+	}
+}
+
+static float textDecode(const char *packet) {
+	char size[10], data[20], dist[10], speed[10];
+	int len = strlen(packet);
+	if (packet[0] != '0' || packet[len - 1] != '1') {
+		return 0;
+	}
+	int index = 3;
+	getString(packet, size, &index);
+	getString(packet, data, &index);
+	getString(packet, dist, &index);
+	getString(packet, speed, &index);
+	return strcmp(data, "drive") == 0 ? atof(dist) * atof(speed) : 0;
+}
+
+static protocolFrame_t randomFrame(mt19937 *rng) {
+	protocolFrame_t frame;
+	frame.op = (*rng)() % PROTOCOL_OPS;
+	frame.seq = (*rng)();
+	frame.value = (float)((*rng)() % 36000) / 100 - 180;
+	frame.speed = (float)((*rng)() % 100) / 100;
+	frame.sentUs = ((uint64_t)(*rng)() << 32) | (*rng)();
+	return frame;
+}
+
+int main(int argc, char *argv[]) {
+	int rounds = argc > 1 ? atoi(argv[1]) : FUZZ_ROUNDS;
+	mt19937 rng(argc > 2 ? atoi(argv[2]) : 1);
+	uint8_t encoded[PROTOCOL_FRAME_SIZE];
+
+	for (int r = 0; r < rounds; r++) {
+		protocolFrame_t frame = randomFrame(&rng);
+		protocolFrame_t decoded;
+		encodeFrame(&frame, encoded);
+
+		if (decodeFrame(encoded, sizeof(encoded), &decoded) != PROTOCOL_OK || decoded.op != frame.op ||
+			decoded.seq != frame.seq || decoded.value != frame.value || decoded.speed != frame.speed ||
+			decoded.sentUs != frame.sentUs) {
+			fail("round trip", encoded, sizeof(encoded));
+		}
+
+		// every truncation is short, read from an exact sized copy so ASan sees overreads
+		size_t cut = rng() % PROTOCOL_FRAME_SIZE;
+		vector<uint8_t> shorter(encoded, encoded + cut);
+		if (decodeFrame(shorter.data(), shorter.size(), &decoded) != PROTOCOL_SHORT) {
+			fail("truncated frame", shorter.data(), shorter.size());
+		}
+
+		// the CRC catches every single bit error
+		vector<uint8_t> flipped(encoded, encoded + PROTOCOL_FRAME_SIZE);
+		flipped[rng() % PROTOCOL_FRAME_SIZE] ^= 1 << (rng() % 8);
+		if (decodeFrame(flipped.data(), flipped.size(), &decoded) == PROTOCOL_OK) {
+			fail("bit flip accepted", flipped.data(), flipped.size());
+		}
+
+		// a few random bytes over a valid frame, then plain noise of any length
+		vector<uint8_t> mutated(encoded, encoded + PROTOCOL_FRAME_SIZE);
+		for (int m = rng() % 4; m >= 0; m--) {
+			mutated[rng() % PROTOCOL_FRAME_SIZE] = rng();
+		}
+		checkDecode(mutated.data(), mutated.size());
+
+		vector<uint8_t> noise(rng() % FUZZ_MAX_SIZE);
+		for (size_t i = 0; i < noise.size(); i++) {
+			noise[i] = rng();
+		}
+		checkDecode(noise.data(), noise.size());
+	}
+	checkDecode(NULL, 0);
+	printf("%d rounds, %d failures\n", rounds, failures);
+
+	// the same drive command both ways
+	const char *text = "0/*11*//*drive*//*20.00*//*0.70*/1";
+	protocolFrame_t frame = {PROTOCOL_DRIVE, 7, 20, 0.7f, 0};
+	encodeFrame(&frame, encoded);
+	volatile float sink = 0;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int i = 0; i < TIMING_ROUNDS; i++) {
+		sink += textDecode(text);
+	}
+	double textNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / TIMING_ROUNDS;
+
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < TIMING_ROUNDS; i++) {
+		protocolFrame_t decoded;
+		decodeFrame(encoded, sizeof(encoded), &decoded);
+		sink += decoded.value * decoded.speed;
+	}
+	double binaryNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / TIMING_ROUNDS;
+
+	printf("text packet %zu bytes, %.1f ns to parse\n", strlen(text) + 1, textNs);
+	printf("binary frame %d bytes, %.1f ns to decode\n", PROTOCOL_FRAME_SIZE, binaryNs);
+	return failures > 0 ? 1 : 0;
+}
+#endif
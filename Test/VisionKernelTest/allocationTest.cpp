@@ -0,0 +1,132 @@
+// Runs the segment, detect and statechart steps of Pascal/Vision/motionTrack.cpp
+// over synthetic frames of a moving ball and fails if any of them still
+// allocates once it is past ALLOC_WARMUP_FRAMES. Needs the build's allocation
+// counting, which CMakeLists.txt turns on for these tests.
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "../../Pascal/Vision/motionTrack.h"
+#include "../../Pascal/Globals/stageStats.h"
+
+using namespace cv;
+using namespace std;
+
+#define TEST_FRAMES (ALLOC_WARMUP_FRAMES + 60)
+#define BALL_RADIUS 30
+#define BALL_STEP 6
+
+static int failures = 0;
+
+// the mode flags one run sets, everything else off
+typedef struct {
+	const char *name;
+	bool track;
+	int pyramid;
+	bool lut;
+	bool change;
+} allocRun_t;
+
+// grey floor, an orange ball bouncing left to right and a blue destination
+static void drawFrame(Mat *frame, int n) {
+	int span = frame->cols - 4 * BALL_RADIUS;
+	int x = (n * BALL_STEP) % (2 * span);
+	if (x > span) {
+		x = 2 * span - x;
+	}
+	frame->setTo(Scalar(90, 90, 90));
+	rectangle(*frame, Rect(frame->cols - 120, 40, 80, 80), Scalar(255, 0, 0), -1);
+	circle(*frame, Point(2 * BALL_RADIUS + x, frame->rows / 2), BALL_RADIUS, Scalar(0, 128, 255), -1);
+}
+
+static void run(const allocRun_t &mode, const vector<hsvRange_t> &ranges) {
+	trackMode = mode.track;
+	pyramidLevel = mode.pyramid;
+	lutMode = mode.lut;
+	changeMode = mode.change;
+
+	colorTargets_t targets;
+	setColorTargets(&targets, ranges, lutMode ? SEGMENT_LUT : SEGMENT_HSV);
+
+	// one packet and the stages' state, as each stage thread keeps them
+	framePacket_t packet;
+	trackShare_t share;
+	segmentWorkspace_t segmentWork;
+	detectState_t detectState;
+	initTrackShare(&share);
+	initDetectState(&detectState);
+	StageStats segmentStats("segment");
+	StageStats detectStats("detect");
+	StageStats statechartStats("statechart");
+
+	packet.frame.create(CAPTURE_HEIGHT, CAPTURE_WIDTH, CV_8UC3);
+	packet.captured.index = -1;
+	long allocations[3] = {0, 0, 0};
+	int found = 0;
+	for (int n = 0; n < TEST_FRAMES; n++) {
+		drawFrame(&packet.frame, n);
+		packet.captured.timestampUs = (int64_t)n * 33333 + 1;
+
+		segmentStats.begin();
+		segmentPacket(&packet, targets, &share, &segmentWork);
+		segmentStats.end();
+
+		detectStats.begin();
+		detectPacket(&packet, &share, &detectState, NULL);
+		detectStats.end();
+
+		statechartStats.begin();
+		decidePacket(&packet, &share);
+		statechartStats.end();
+
+		if (n >= ALLOC_WARMUP_FRAMES) {
+			allocations[0] += segmentStats.lastAllocations();
+			allocations[1] += detectStats.lastAllocations();
+			allocations[2] += statechartStats.lastAllocations();
+			found += !packet.isOffscreen;
+		}
+	}
+
+	const char *stages[3] = {"segment", "detect", "statechart"};
+	int counted = TEST_FRAMES - ALLOC_WARMUP_FRAMES;
+	printf("%s: %.2f %.2f %.2f allocations per frame (segment, detect, statechart), ball seen in %d of %d\n", mode.name,
+		   (double)allocations[0] / counted, (double)allocations[1] / counted, (double)allocations[2] / counted, found, counted);
+	for (int s = 0; s < 3; s++) {
+		if (allocations[s] != 0) {
+			printf("FAIL %s: %s allocated %ld times after warm up\n", mode.name, stages[s], allocations[s]);
+			failures++;
+		}
+	}
+	// a pipeline that lost the ball would not allocate either, so the run has to see it
+	if (found == 0) {
+		printf("FAIL %s: the ball was never found\n", mode.name);
+		failures++;
+	}
+}
+
+int main() {
+	if (!countingAllocations()) {
+		printf("FAIL: built without COUNT_ALLOCATIONS, nothing was counted\n");
+		return 1;
+	}
+
+	vector<hsvRange_t> ranges(2);
+	ranges[OBJECT_TARGET].lowerBound = Scalar(5, 100, 100);
+	ranges[OBJECT_TARGET].upperBound = Scalar(25, 255, 255);
+	ranges[DEST_TARGET].lowerBound = Scalar(110, 100, 100);
+	ranges[DEST_TARGET].upperBound = Scalar(130, 255, 255);
+
+	allocRun_t modes[] = {
+		{"full frame", false, 0, false, false},
+		{"tracked windows (-t)", true, 0, false, false},
+		{"pyramid (-p 1)", false, 1, false, false},
+		{"colour table (-l)", false, 0, true, false},
+		{"changed tiles (-u)", false, 0, false, true},
+	};
+	for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+		run(modes[m], ranges);
+	}
+
+	printf("%s: %d failures\n", failures ? "FAIL" : "PASS", failures);
+	return failures ? 1 : 0;
+}
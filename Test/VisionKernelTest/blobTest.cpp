@@ -0,0 +1,152 @@
+// Checks extractBlobs in Pascal/Vision/blob.cpp, which labels runs with union
+// find, against a plain 8-connected flood fill over the same random masks.
+// Every component has to come out with the same area, box and moments.
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <random>
+#include <opencv2/opencv.hpp>
+#include "../../Pascal/Vision/blob.h"
+
+using namespace cv;
+using namespace std;
+
+#define BLOB_ROUNDS 30
+#define MOMENT_TOLERANCE 1e-6
+
+static int failures = 0;
+
+// Labels the components of a 0/1 mask one at a time by flood fill and sums
+// their moments, coordinates are relative to the mask.
+static void floodFillBlobs(const vector<int> &mask, int rows, int cols, vector<blobSums_t> *sums) {
+	vector<int> label(rows * cols, -1);
+	vector<int> stack;
+	sums->clear();
+
+	for (int start = 0; start < rows * cols; start++) {
+		if (!mask[start] || label[start] >= 0) {
+			continue;
+		}
+		blobSums_t s = {0, 0, 0, 0, 0, 0, cols, rows, -1, -1};
+		label[start] = sums->size();
+		stack.push_back(start);
+		while (!stack.empty()) {
+			int p = stack.back();
+			stack.pop_back();
+			int x = p % cols;
+			int y = p / cols;
+			s.m00 += 1;
+			s.m10 += x;
+			s.m01 += y;
+			s.m20 += (double)x * x;
+			s.m02 += (double)y * y;
+			s.m11 += (double)x * y;
+			s.minX = min(s.minX, x);
+			s.minY = min(s.minY, y);
+			s.maxX = max(s.maxX, x);
+			s.maxY = max(s.maxY, y);
+			for (int dy = -1; dy <= 1; dy++) {
+				for (int dx = -1; dx <= 1; dx++) {
+					int nx = x + dx;
+					int ny = y + dy;
+					if (nx < 0 || nx >= cols || ny < 0 || ny >= rows) {
+						continue;
+					}
+					int n = ny * cols + nx;
+					if (mask[n] && label[n] < 0) {
+						label[n] = label[start];
+						stack.push_back(n);
+					}
+				}
+			}
+		}
+		sums->push_back(s);
+	}
+}
+
+static bool closeTo(double a, double b) {
+	return fabs(a - b) <= MOMENT_TOLERANCE * (1 + fabs(b));
+}
+
+// the blob that matches a flood filled component, found in any order
+static bool matches(const blob_t &blob, const blobSums_t &s, Point offset) {
+	double cx = s.m10 / s.m00;
+	double cy = s.m01 / s.m00;
+	Rect box(s.minX + offset.x, s.minY + offset.y, s.maxX - s.minX + 1, s.maxY - s.minY + 1);
+	return blob.area == (int)s.m00 && blob.box == box &&
+		   fabs(blob.centroid.x - (cx + offset.x)) < 1e-3 && fabs(blob.centroid.y - (cy + offset.y)) < 1e-3 &&
+		   closeTo(blob.mu20, s.m20 - cx * s.m10) && closeTo(blob.mu02, s.m02 - cy * s.m01) &&
+		   closeTo(blob.mu11, s.m11 - cx * s.m01);
+}
+
+int main() {
+	mt19937 rng(2);
+	blobWorkspace_t work;
+	vector<blob_t> blobs;
+	vector<blobSums_t> expected;
+	// rows and columns around the word size, where runs cross word boundaries
+	int sizes[][2] = {{1, 1}, {3, 5}, {7, 63}, {9, 64}, {11, 65}, {20, 127}, {33, 128}, {40, 200}, {5, 130}, {64, 64}};
+
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		int rows = sizes[s][0];
+		int cols = sizes[s][1];
+		for (int round = 0; round < BLOB_ROUNDS; round++) {
+			// from empty to full, the middle densities give many touching components
+			int density = 1000 * (round % 6) / 5;
+			Mat mask(rows, cols, CV_8UC1);
+			vector<int> bits(rows * cols);
+			for (int y = 0; y < rows; y++) {
+				uchar *p = mask.ptr<uchar>(y);
+				for (int x = 0; x < cols; x++) {
+					bits[y * cols + x] = (int)(rng() % 1000) < density;
+					p[x] = bits[y * cols + x] ? 255 : 0;
+				}
+			}
+
+			BitMask packed;
+			Point offset(round, 2 * round);
+			packMask(mask, &packed);
+			extractBlobs(packed, offset, &blobs, &work);
+			floodFillBlobs(bits, rows, cols, &expected);
+
+			if (blobs.size() != expected.size()) {
+				printf("FAIL %dx%d round %d: %zu blobs, flood fill finds %zu\n", cols, rows, round, blobs.size(), expected.size());
+				failures++;
+				continue;
+			}
+			vector<bool> used(blobs.size(), false);
+			for (size_t e = 0; e < expected.size(); e++) {
+				bool found = false;
+				for (size_t b = 0; b < blobs.size() && !found; b++) {
+					if (!used[b] && matches(blobs[b], expected[e], offset)) {
+						used[b] = found = true;
+					}
+				}
+				if (!found) {
+					printf("FAIL %dx%d round %d: no blob matches component %zu of area %.0f\n", cols, rows, round, e, expected[e].m00);
+					failures++;
+				}
+			}
+		}
+	}
+
+	// a filled disc's moment radius is its real radius, what detectObject relies on
+	Mat disc(200, 200, CV_8UC1);
+	for (int y = 0; y < disc.rows; y++) {
+		for (int x = 0; x < disc.cols; x++) {
+			disc.ptr<uchar>(y)[x] = (x - 100) * (x - 100) + (y - 90) * (y - 90) <= 50 * 50 ? 255 : 0;
+		}
+	}
+	BitMask packed;
+	packMask(disc, &packed);
+	extractBlobs(packed, Point(), &blobs, &work);
+	if (blobs.size() != 1 || fabs(blobs[0].radius - 50) > 0.5 || fabs(blobs[0].centroid.x - 100) > 1e-3 ||
+		fabs(blobs[0].centroid.y - 90) > 1e-3) {
+		printf("FAIL disc: expected one blob of radius 50 at (100, 90)\n");
+		failures++;
+	}
+
+	printf("%s: %d failures\n", failures ? "FAIL" : "PASS", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,166 @@
+// Checks the -u change detection of Pascal/Vision/changeDetect.cpp and the
+// tile cache in Pascal/Vision/motionTrack.cpp on a static scene with one tile
+// changed: only that tile may count as changed, and the merged masks must be
+// the ones a full frame pass over the new frame gives, also when the change
+// touches the tile's edge and the blur carries it into the next tile.
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "../../Pascal/Vision/motionTrack.h"
+
+using namespace cv;
+using namespace std;
+
+// the tile that changes, in tiles, and the patch drawn well inside it
+#define CHANGED_TILE_X 3
+#define CHANGED_TILE_Y 4
+#define PATCH_MARGIN 16
+// the patch along the right edge of the tile, in pixels wide
+#define EDGE_PATCH_WIDTH 8
+
+static int failures = 0;
+
+// grey floor, an orange ball and a blue destination, nothing moves
+static void drawScene(Mat *frame, int floor = 90) {
+	frame->setTo(Scalar(floor, floor, floor));
+	rectangle(*frame, Rect(frame->cols - 120, 40, 80, 80), Scalar(255, 0, 0), -1);
+	circle(*frame, Point(160, frame->rows / 2), 30, Scalar(0, 128, 255), -1);
+}
+
+// an orange patch inside the changed tile, far enough from its edges that
+// neither the blur nor the cleaning reach the tiles around it
+static Rect patchRect() {
+	return Rect(CHANGED_TILE_X * CHANGE_TILE_WIDTH + PATCH_MARGIN, CHANGED_TILE_Y * CHANGE_TILE_HEIGHT + PATCH_MARGIN,
+				CHANGE_TILE_WIDTH - 2 * PATCH_MARGIN, CHANGE_TILE_HEIGHT - 2 * PATCH_MARGIN);
+}
+
+// an orange strip inside the changed tile against its right edge
+static Rect edgePatchRect() {
+	return Rect((CHANGED_TILE_X + 1) * CHANGE_TILE_WIDTH - EDGE_PATCH_WIDTH, CHANGED_TILE_Y * CHANGE_TILE_HEIGHT + PATCH_MARGIN,
+				EDGE_PATCH_WIDTH, CHANGE_TILE_HEIGHT - 2 * PATCH_MARGIN);
+}
+
+static int countDifferent(const BitMask &a, const BitMask &b) {
+	int different = 0;
+	for (int y = 0; y < a.rows; y++) {
+		for (int x = 0; x < a.cols; x++) {
+			different += a.get(y, x) != b.get(y, x);
+		}
+	}
+	return different;
+}
+
+static void checkDetector() {
+	Mat frame(CAPTURE_HEIGHT, CAPTURE_WIDTH, CV_8UC3);
+	int tiles = ((frame.cols + CHANGE_TILE_WIDTH - 1) / CHANGE_TILE_WIDTH) *
+				((frame.rows + CHANGE_TILE_HEIGHT - 1) / CHANGE_TILE_HEIGHT);
+	ChangeDetector changes;
+	vector<Rect> runs;
+
+	drawScene(&frame);
+	if (changes.update(frame) != tiles) {
+		printf("FAIL detector: the first frame must change every tile\n");
+		failures++;
+	}
+	changes.accept();
+
+	if (changes.update(frame) != 0) {
+		printf("FAIL detector: a static frame changed tiles\n");
+		failures++;
+	}
+
+	// a step of the floor's luma below the threshold is noise, not a change
+	Mat brighter = frame.clone();
+	drawScene(&brighter, 90 + CHANGE_THRESHOLD - 2);
+	if (changes.update(brighter) != 0) {
+		printf("FAIL detector: a luma step of %d changed tiles\n", CHANGE_THRESHOLD - 2);
+		failures++;
+	}
+
+	Mat moved = frame.clone();
+	rectangle(moved, patchRect(), Scalar(0, 128, 255), -1);
+	int changed = changes.update(moved);
+	changes.changedRuns(&runs);
+	Rect tile(CHANGED_TILE_X * CHANGE_TILE_WIDTH, CHANGED_TILE_Y * CHANGE_TILE_HEIGHT, CHANGE_TILE_WIDTH, CHANGE_TILE_HEIGHT);
+	if (changed != 1 || runs.size() != 1 || runs[0] != tile) {
+		printf("FAIL detector: one changed tile gave %d tiles in %d runs\n", changed, (int)runs.size());
+		failures++;
+	}
+
+	// once accepted the new frame is the reference, until then it keeps changing
+	if (changes.update(moved) != 1) {
+		printf("FAIL detector: the tile stopped changing before it was accepted\n");
+		failures++;
+	}
+	changes.accept();
+	if (changes.update(moved) != 0) {
+		printf("FAIL detector: the accepted tile still changed\n");
+		failures++;
+	}
+}
+
+static void checkCache(const colorTargets_t &targets, Rect patch, const char *name) {
+	framePacket_t packet;
+	trackShare_t share;
+	segmentWorkspace_t work;
+	initTrackShare(&share);
+
+	packet.frame.create(CAPTURE_HEIGHT, CAPTURE_WIDTH, CV_8UC3);
+	drawScene(&packet.frame);
+	segmentPacket(&packet, targets, &share, &work);
+	if (packet.unchanged) {
+		printf("FAIL cache %s: the first frame was taken as unchanged\n", name);
+		failures++;
+	}
+
+	segmentPacket(&packet, targets, &share, &work);
+	if (!packet.unchanged) {
+		printf("FAIL cache %s: a static frame was segmented again\n", name);
+		failures++;
+	}
+
+	rectangle(packet.frame, patch, Scalar(0, 128, 255), -1);
+	segmentPacket(&packet, targets, &share, &work);
+	if (packet.unchanged || work.runs.size() != 1) {
+		printf("FAIL cache %s: one changed tile gave %d runs\n", name, (int)work.runs.size());
+		failures++;
+	}
+
+	// the masks a full frame pass over the new frame gives
+	vector<BitMask> expected;
+	blurWorkspace_t blur;
+	BitMask temp;
+	segmentFrame(&packet.frame, targets, &expected, &blur);
+	for (int t = 0; t < (int)expected.size(); t++) {
+		cleanMask(&expected[t], &temp);
+		int different = countDifferent(packet.masks[t], expected[t]);
+		if (different > 0) {
+			printf("FAIL cache %s: target %d has %d pixels unlike a full frame pass\n", name, t, different);
+			failures++;
+		}
+	}
+	if (!packet.masks[OBJECT_TARGET].get(patch.y + patch.height / 2, patch.x + patch.width / 2)) {
+		printf("FAIL cache %s: the new patch is missing from the object mask\n", name);
+		failures++;
+	}
+}
+
+int main() {
+	changeMode = true;
+
+	vector<hsvRange_t> ranges(2);
+	ranges[OBJECT_TARGET].lowerBound = Scalar(5, 100, 100);
+	ranges[OBJECT_TARGET].upperBound = Scalar(25, 255, 255);
+	ranges[DEST_TARGET].lowerBound = Scalar(110, 100, 100);
+	ranges[DEST_TARGET].upperBound = Scalar(130, 255, 255);
+	colorTargets_t targets;
+	setColorTargets(&targets, ranges, SEGMENT_HSV);
+
+	checkDetector();
+	checkCache(targets, patchRect(), "inside");
+	checkCache(targets, edgePatchRect(), "tile edge");
+
+	printf("%s: %d failures\n", failures ? "FAIL" : "PASS", failures);
+	return failures ? 1 : 0;
+}
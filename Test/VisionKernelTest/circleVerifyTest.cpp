@@ -0,0 +1,158 @@
+// Pins the shape scores of Pascal/Vision/circleVerify.cpp on synthetic masks:
+// discs are accepted from their moments alone, squares, rings and bars are
+// rejected without Hough, and elongated or cut off discs are left to Hough.
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <random>
+#include <opencv2/opencv.hpp>
+#include "../../Pascal/Vision/blob.h"
+#include "../../Pascal/Vision/circleVerify.h"
+
+using namespace cv;
+using namespace std;
+
+#define SHAPE_SIZE 240
+#define SHAPE_CENTER 120
+
+// where a shape's score has to land
+#define EXPECT_ACCEPT 0
+#define EXPECT_AMBIGUOUS 1
+#define EXPECT_REJECT 2
+
+static int failures = 0;
+static mt19937 rng(3);
+
+// one shape, true for the pixels inside it, relative to the centre
+typedef bool (*shape_t)(double x, double y, double size);
+
+static bool disc(double x, double y, double r) {
+	return x * x + y * y <= r * r;
+}
+
+static bool square(double x, double y, double side) {
+	return fabs(x) < side / 2 && fabs(y) < side / 2;
+}
+
+static bool diamond(double x, double y, double side) {
+	return fabs(x) + fabs(y) < side / 2;
+}
+
+static bool rotatedSquare(double x, double y, double side) {
+	double c = cos(CV_PI / 6);
+	double s = sin(CV_PI / 6);
+	return square(x * c + y * s, -x * s + y * c, side);
+}
+
+// twice as wide as high, e.g. a ball smeared by motion blur
+static bool ellipse2(double x, double y, double r) {
+	return x * x / 4 + y * y <= r * r;
+}
+
+// cut off by the frame edge
+static bool halfDisc(double x, double y, double r) {
+	return disc(x, y, r) && x < 0;
+}
+
+// a quarter hidden behind something
+static bool threeQuarterDisc(double x, double y, double r) {
+	return disc(x, y, r) && x < r / 2;
+}
+
+static bool ring(double x, double y, double r) {
+	return disc(x, y, r) && !disc(x, y, r * 0.8);
+}
+
+static bool bar(double x, double y, double length) {
+	return fabs(x) < length / 2 && fabs(y) < 5;
+}
+
+// the shape's mask with noise pixels flipped along its edge, its score and the verdict without Hough
+static void check(const char *name, shape_t shape, double size, double noise, int expect) {
+	Mat mask(SHAPE_SIZE, SHAPE_SIZE, CV_8UC1);
+	uniform_real_distribution<double> chance(0, 1);
+	for (int y = 0; y < SHAPE_SIZE; y++) {
+		uchar *p = mask.ptr<uchar>(y);
+		for (int x = 0; x < SHAPE_SIZE; x++) {
+			double dx = x - SHAPE_CENTER;
+			double dy = y - SHAPE_CENTER;
+			bool inside = shape(dx, dy, size);
+			bool edge = shape(dx - 2, dy, size) != shape(dx + 2, dy, size) || shape(dx, dy - 2, size) != shape(dx, dy + 2, size);
+			if (edge && chance(rng) < noise) {
+				inside = !inside;
+			}
+			p[x] = inside ? 255 : 0;
+		}
+	}
+
+	// cleaned like segment.cpp's cleanMask does before the blobs are found
+	BitMask bits;
+	BitMask temp;
+	blobWorkspace_t work;
+	vector<blob_t> blobs;
+	packMask(mask, &bits);
+	openMask(&bits, &temp);
+	closeMask(&bits, &temp);
+	extractBlobs(bits, Point(), &blobs, &work);
+	int largest = largestBlob(blobs);
+	if (largest < 0) {
+		printf("FAIL %s: no blob\n", name);
+		failures++;
+		return;
+	}
+
+	circleScore_t score;
+	scoreCircle(blobs[largest], &score);
+	int got = score.score >= CIRCLE_ACCEPT ? EXPECT_ACCEPT : score.score < CIRCLE_REJECT ? EXPECT_REJECT : EXPECT_AMBIGUOUS;
+	const char *verdicts[3] = {"accepted", "ambiguous", "rejected"};
+	printf("%-16s circularity %.2f fill %.2f consistency %.2f score %.2f %s\n", name, score.circularity, score.fill,
+		   score.consistency, score.score, verdicts[got]);
+	if (got != expect) {
+		printf("FAIL %s: expected %s\n", name, verdicts[expect]);
+		failures++;
+		return;
+	}
+
+	// a clear score is settled without Hough, so no mask is needed for it
+	if (expect != EXPECT_AMBIGUOUS) {
+		circleCheck_t circleCheck;
+		circleCheck.mask = NULL;
+		if (verifyCircle(blobs[largest], &score, &circleCheck) != (expect == EXPECT_ACCEPT) || score.hough) {
+			printf("FAIL %s: verifyCircle disagrees with the score\n", name);
+			failures++;
+		}
+	}
+}
+
+int main() {
+	char name[32];
+	int radii[] = {6, 8, 12, 20, 35, 60, 100};
+	for (size_t i = 0; i < sizeof(radii) / sizeof(radii[0]); i++) {
+		sprintf(name, "disc r%d", radii[i]);
+		check(name, disc, radii[i], 0, EXPECT_ACCEPT);
+	}
+	// edge noise from segmentation, a few percent of the rim flipped
+	check("noisy disc r20", disc, 20, 0.05, EXPECT_ACCEPT);
+	check("noisy disc r40", disc, 40, 0.15, EXPECT_ACCEPT);
+
+	// large blobs that are not round, which used to be taken for the ball
+	int sides[] = {20, 40, 80, 160};
+	for (size_t i = 0; i < sizeof(sides) / sizeof(sides[0]); i++) {
+		sprintf(name, "square %d", sides[i]);
+		check(name, square, sides[i], 0, EXPECT_REJECT);
+	}
+	check("square 30deg 80", rotatedSquare, 80, 0, EXPECT_REJECT);
+	check("diamond 80", diamond, 80, 0, EXPECT_REJECT);
+	check("noisy square 80", square, 80, 0.05, EXPECT_REJECT);
+	check("ring r50", ring, 50, 0, EXPECT_REJECT);
+	check("bar 160", bar, 160, 0, EXPECT_REJECT);
+
+	// round but not a whole disc, Hough decides
+	check("ellipse 2:1 r30", ellipse2, 30, 0, EXPECT_AMBIGUOUS);
+	check("half disc r50", halfDisc, 50, 0, EXPECT_AMBIGUOUS);
+	check("3/4 disc r50", threeQuarterDisc, 50, 0, EXPECT_AMBIGUOUS);
+
+	printf("%s: %d failures\n", failures ? "FAIL" : "PASS", failures);
+	return failures ? 1 : 0;
+}
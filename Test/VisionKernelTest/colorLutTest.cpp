@@ -0,0 +1,109 @@
+// Checks the quantized colour table in Pascal/Vision/colorLut.cpp against the
+// exact HSV kernel over every BGR colour. A table entry holds the class of its
+// bin's centre, so colours may only differ in bins the exact kernel splits,
+// i.e. on a range boundary, and the share of colours that differ stays small.
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "../../Pascal/Vision/colorLut.h"
+
+using namespace cv;
+using namespace std;
+
+#define CUBE_SIDE 4096
+// colours per bin along one channel
+#define BIN_SIDE (1 << (8 - LUT_BITS))
+// share of all colours allowed to classify differently, percent. user-016 measured 0.3%
+#define LUT_MAX_MISMATCH 0.5
+
+static int failures = 0;
+
+// colour i of the cube is at pixel i, blue in the high bits so a bin's colours are easy to walk
+static int colourIndex(int b, int g, int r) {
+	return (b << 16) | (g << 8) | r;
+}
+
+static bool maskBit(const BitMask &mask, int colour) {
+	return mask.get(colour / CUBE_SIDE, colour % CUBE_SIDE);
+}
+
+int main() {
+	vector<hsvRange_t> ranges(3);
+	ranges[0].lowerBound = Scalar(5, 120, 100);		// the orange ball
+	ranges[0].upperBound = Scalar(25, 255, 255);
+	ranges[1].lowerBound = Scalar(170, 80, 60);		// red, wraps around 180
+	ranges[1].upperBound = Scalar(10, 255, 255);
+	ranges[2].lowerBound = Scalar(100, 40, 40);		// a dull blue
+	ranges[2].upperBound = Scalar(130, 200, 200);
+
+	colorTargets_t exact;
+	colorTargets_t lut;
+	setColorTargets(&exact, ranges, SEGMENT_HSV);
+	setColorTargets(&lut, ranges, SEGMENT_LUT);
+
+	Mat cube(CUBE_SIDE, CUBE_SIDE, CV_8UC3);
+	for (int y = 0; y < CUBE_SIDE; y++) {
+		uchar *p = cube.ptr<uchar>(y);
+		for (int x = 0; x < CUBE_SIDE; x++) {
+			int colour = y * CUBE_SIDE + x;
+			p[3 * x] = colour >> 16;
+			p[3 * x + 1] = (colour >> 8) & 255;
+			p[3 * x + 2] = colour & 255;
+		}
+	}
+	vector<BitMask> expected;
+	vector<BitMask> masks;
+	thresholdTargets(cube, exact, &expected);
+	thresholdTargets(cube, lut, &masks);
+
+	for (int t = 0; t < (int)ranges.size(); t++) {
+		long differ = 0;
+		long inUniformBins = 0;
+		long classifyDiffers = 0;
+		for (int b0 = 0; b0 < 256; b0 += BIN_SIDE) {
+			for (int g0 = 0; g0 < 256; g0 += BIN_SIDE) {
+				for (int r0 = 0; r0 < 256; r0 += BIN_SIDE) {
+					// does the exact kernel split this bin
+					bool first = maskBit(expected[t], colourIndex(b0, g0, r0));
+					bool uniform = true;
+					long binDiffer = 0;
+					for (int b = b0; b < b0 + BIN_SIDE; b++) {
+						for (int g = g0; g < g0 + BIN_SIDE; g++) {
+							for (int r = r0; r < r0 + BIN_SIDE; r++) {
+								int colour = colourIndex(b, g, r);
+								bool want = maskBit(expected[t], colour);
+								bool got = maskBit(masks[t], colour);
+								uniform = uniform && want == first;
+								binDiffer += want != got;
+								classifyDiffers += got != (((lut.lut.classify(b, g, r) >> t) & 1) != 0);
+							}
+						}
+					}
+					differ += binDiffer;
+					if (uniform) {
+						inUniformBins += binDiffer;
+					}
+				}
+			}
+		}
+
+		double percent = 100.0 * differ / ((double)CUBE_SIDE * CUBE_SIDE);
+		printf("target %d: %ld colours differ (%.3f%%)\n", t, differ, percent);
+		if (inUniformBins > 0) {
+			printf("FAIL target %d: %ld colours differ away from any range boundary\n", t, inUniformBins);
+			failures++;
+		}
+		if (percent > LUT_MAX_MISMATCH) {
+			printf("FAIL target %d: %.3f%% of colours differ, more than %.1f%%\n", t, percent, LUT_MAX_MISMATCH);
+			failures++;
+		}
+		if (classifyDiffers > 0) {
+			printf("FAIL target %d: threshold and classify disagree on %ld colours\n", t, classifyDiffers);
+			failures++;
+		}
+	}
+
+	printf("%s: %d failures\n", failures ? "FAIL" : "PASS", failures);
+	return failures ? 1 : 0;
+}
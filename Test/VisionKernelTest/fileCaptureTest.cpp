@@ -0,0 +1,162 @@
+// Checks FileCapture of Pascal/Vision/v4l2Capture.cpp on a small raw YUYV
+// recording written by the test: frames come out in order with the bytes of
+// the file, numbered and spaced at the given fps, release hands them back,
+// and a partial frame at the end of the file is not a frame.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "../../Pascal/Vision/v4l2Capture.h"
+
+using namespace cv;
+using namespace std;
+
+#define TEST_WIDTH 64
+#define TEST_HEIGHT 48
+#define TEST_FRAMES 5
+#define TEST_FPS 25
+#define FRAME_BYTES (TEST_WIDTH * TEST_HEIGHT * 2)
+
+static int failures = 0;
+
+// byte i of frame n, different in every frame and along every row
+static uchar frameByte(int n, int i) {
+	return (uchar)(n * 37 + i * 7 + i / (TEST_WIDTH * 2));
+}
+
+// the frames back to back, then half a frame as a recording cut short leaves
+static bool writeRecording(const char *path) {
+	FILE *f = fopen(path, "wb");
+	if (f == NULL) {
+		return false;
+	}
+	vector<uchar> bytes(FRAME_BYTES);
+	for (int n = 0; n <= TEST_FRAMES; n++) {
+		for (int i = 0; i < FRAME_BYTES; i++) {
+			bytes[i] = frameByte(n, i);
+		}
+		fwrite(&bytes[0], 1, n < TEST_FRAMES ? FRAME_BYTES : FRAME_BYTES / 2, f);
+	}
+	return fclose(f) == 0;
+}
+
+static bool sameBytes(const Mat &image, int n) {
+	for (int y = 0; y < image.rows; y++) {
+		const uchar *row = image.ptr<uchar>(y);
+		for (int x = 0; x < TEST_WIDTH * 2; x++) {
+			if (row[x] != frameByte(n, y * TEST_WIDTH * 2 + x)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static void checkFrames(const char *path) {
+	FileCapture recording;
+	captureFrame_t frame;
+
+	int64_t before = monotonicUs();
+	if (!recording.open(path, TEST_WIDTH, TEST_HEIGHT, V4L2_PIX_FMT_YUYV, TEST_FPS)) {
+		printf("FAIL frames: could not open the recording\n");
+		failures++;
+		return;
+	}
+	int64_t after = monotonicUs();
+
+	int64_t firstUs = 0;
+	for (int n = 0; n < TEST_FRAMES; n++) {
+		if (!recording.grab(&frame)) {
+			printf("FAIL frames: frame %d of %d was not grabbed\n", n, TEST_FRAMES);
+			failures++;
+			return;
+		}
+		if (frame.image.rows != TEST_HEIGHT || frame.image.cols != TEST_WIDTH || frame.image.type() != CV_8UC2 ||
+			frame.fourcc != V4L2_PIX_FMT_YUYV) {
+			printf("FAIL frames: frame %d is %dx%d of type %d\n", n, frame.image.cols, frame.image.rows, frame.image.type());
+			failures++;
+		} else if (!sameBytes(frame.image, n)) {
+			printf("FAIL frames: frame %d does not hold the bytes written\n", n);
+			failures++;
+		}
+		if (frame.index != n || (int)frame.sequence != n) {
+			printf("FAIL frames: frame %d has index %d and sequence %u\n", n, frame.index, frame.sequence);
+			failures++;
+		}
+
+		// the first frame is stamped when the file is opened, the rest 1 / fps apart
+		if (n == 0) {
+			firstUs = frame.timestampUs;
+			if (firstUs < before || firstUs > after) {
+				printf("FAIL frames: the first timestamp is not the time of opening\n");
+				failures++;
+			}
+		} else if (frame.timestampUs - firstUs != (int64_t)n * 1000000 / TEST_FPS) {
+			printf("FAIL frames: frame %d is %lld us after the first\n", n, (long long)(frame.timestampUs - firstUs));
+			failures++;
+		}
+
+		// the mapping is private, the pipeline may draw on a frame without touching the file
+		frame.image.setTo(Scalar(0, 0));
+
+		recording.release(&frame);
+		if (!frame.image.empty() || frame.index != -1) {
+			printf("FAIL frames: frame %d still holds its buffer after release\n", n);
+			failures++;
+		}
+	}
+
+	// the half frame at the end is not handed out, and the end stays the end
+	for (int i = 0; i < 2; i++) {
+		if (recording.grab(&frame) || frame.index != -1) {
+			printf("FAIL frames: grabbed past the last whole frame\n");
+			failures++;
+		}
+	}
+	recording.close();
+	if (recording.grab(&frame)) {
+		printf("FAIL frames: grabbed after close\n");
+		failures++;
+	}
+
+	// drawing on the frames left the recording as it was
+	if (!recording.open(path, TEST_WIDTH, TEST_HEIGHT, V4L2_PIX_FMT_YUYV, TEST_FPS) || !recording.grab(&frame) ||
+		!sameBytes(frame.image, 0)) {
+		printf("FAIL frames: drawing on a frame changed the recording\n");
+		failures++;
+	}
+}
+
+// files that hold no whole frame, or are not there, do not open
+static void checkOpen(const char *path) {
+	FileCapture recording;
+
+	if (recording.open(path, TEST_WIDTH * 4, TEST_HEIGHT * 4)) {
+		printf("FAIL open: a file smaller than one frame opened\n");
+		failures++;
+	}
+	recording.close();
+	if (recording.open("/nonexistent/recording.yuv", TEST_WIDTH, TEST_HEIGHT)) {
+		printf("FAIL open: a missing file opened\n");
+		failures++;
+	}
+}
+
+int main() {
+	char path[] = "/tmp/fileCaptureTestXXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0 || !writeRecording(path)) {
+		printf("FAIL: could not write the recording\n");
+		return 1;
+	}
+	close(fd);
+
+	checkFrames(path);
+	checkOpen(path);
+	unlink(path);
+
+	printf("%s: %d failures\n", failures ? "FAIL" : "PASS", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,106 @@
+// Checks the fused threshold kernel in Pascal/Vision/hsvThreshold.cpp against
+// OpenCV's cvtColor + inRange, which it replaced. The kernel uses OpenCV's own
+// fixed point tables, so every pixel of every mask has to match.
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <random>
+#include <opencv2/opencv.hpp>
+#include "../../Pascal/Vision/hsvThreshold.h"
+
+using namespace cv;
+using namespace std;
+
+// the whole BGR cube, one pixel per colour
+#define CUBE_SIDE 4096
+
+static int failures = 0;
+
+static hsvRange_t range(int hLow, int sLow, int vLow, int hHigh, int sHigh, int vHigh) {
+	hsvRange_t r;
+	r.lowerBound = Scalar(hLow, sLow, vLow);
+	r.upperBound = Scalar(hHigh, sHigh, vHigh);
+	return r;
+}
+
+// the mask the old filterImage path gave, a wrapped hue range is the union of its two halves
+static void referenceMask(const Mat &hsv, const hsvRange_t &r, Mat *mask) {
+	Scalar lower = r.lowerBound;
+	Scalar upper = r.upperBound;
+	if (lower[0] <= upper[0]) {
+		inRange(hsv, lower, upper, *mask);
+		return;
+	}
+	Mat high;
+	inRange(hsv, Scalar(lower[0], lower[1], lower[2]), Scalar(179, upper[1], upper[2]), *mask);
+	inRange(hsv, Scalar(0, lower[1], lower[2]), Scalar(upper[0], upper[1], upper[2]), high);
+	bitwise_or(*mask, high, *mask);
+}
+
+static void check(const char *name, const Mat &bgr, const vector<hsvRange_t> &ranges) {
+	Mat hsv;
+	cvtColor(bgr, hsv, COLOR_BGR2HSV);
+
+	// both outputs, the byte masks and the bit masks the pipeline uses
+	vector<Mat> masks;
+	vector<BitMask> bits;
+	thresholdBGR(bgr, ranges, &masks);
+	thresholdBGR(bgr, ranges, &bits);
+
+	for (size_t i = 0; i < ranges.size(); i++) {
+		Mat expected;
+		Mat diff;
+		Mat unpacked;
+		referenceMask(hsv, ranges[i], &expected);
+		compare(masks[i], expected, diff, CMP_NE);
+		int bad = countNonZero(diff);
+		unpackMask(bits[i], &unpacked);
+		compare(unpacked, expected, diff, CMP_NE);
+		bad += countNonZero(diff);
+		if (bad > 0) {
+			printf("FAIL %s range %zu: %d pixels differ from cvtColor + inRange\n", name, i, bad);
+			failures++;
+		}
+	}
+}
+
+int main() {
+	vector<hsvRange_t> ranges;
+	ranges.push_back(range(0, 76, 0, 179, 255, 255));		// everything saturated
+	ranges.push_back(range(170, 100, 50, 10, 255, 255));	// red, wraps around 180
+	ranges.push_back(range(20, 30, 40, 40, 200, 220));		// a narrow box
+	ranges.push_back(range(0, 0, 0, 0, 0, 0));				// black only
+	ranges.push_back(range(90, 1, 1, 120, 254, 254));		// bounds one off the ends
+
+	// every colour once, so no corner of the table lookups is missed
+	Mat cube(CUBE_SIDE, CUBE_SIDE, CV_8UC3);
+	for (int y = 0; y < CUBE_SIDE; y++) {
+		uchar *p = cube.ptr<uchar>(y);
+		for (int x = 0; x < CUBE_SIDE; x++) {
+			int colour = y * CUBE_SIDE + x;
+			p[3 * x] = colour & 255;
+			p[3 * x + 1] = (colour >> 8) & 255;
+			p[3 * x + 2] = colour >> 16;
+		}
+	}
+	check("cube", cube, ranges);
+
+	// widths that are not a multiple of the SIMD lanes or of 64, so the row tails run too
+	mt19937 rng(1);
+	int widths[] = {1, 3, 7, 63, 65, 127, 641};
+	for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++) {
+		Mat image(9, widths[w], CV_8UC3);
+		for (int y = 0; y < image.rows; y++) {
+			uchar *p = image.ptr<uchar>(y);
+			for (int x = 0; x < 3 * image.cols; x++) {
+				p[x] = rng() & 255;
+			}
+		}
+		char name[32];
+		sprintf(name, "random %dx%d", image.cols, image.rows);
+		check(name, image, ranges);
+	}
+
+	printf("%s: %d failures\n", failures ? "FAIL" : "PASS", failures);
+	return failures ? 1 : 0;
+}
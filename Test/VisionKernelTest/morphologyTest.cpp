@@ -0,0 +1,90 @@
+// Checks the word parallel morphology in Pascal/Vision/bitMask.cpp against
+// cv::erode and cv::dilate with the 5x5 ellipse filterMask used before it.
+// The borders follow OpenCV's defaults, so every pixel has to match.
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <random>
+#include <opencv2/opencv.hpp>
+#include "../../Pascal/Vision/bitMask.h"
+
+using namespace cv;
+using namespace std;
+
+#define MORPH_ROUNDS 20
+
+static int failures = 0;
+
+static int differences(const BitMask &bits, const Mat &expected) {
+	Mat unpacked;
+	Mat diff;
+	unpackMask(bits, &unpacked);
+	compare(unpacked, expected, diff, CMP_NE);
+	int bad = countNonZero(diff);
+
+	// the padding bits past the last column have to stay clear
+	for (int y = 0; y < bits.rows; y++) {
+		if (bits.row(y)[bits.wordsPerRow - 1] & ~bits.lastWordMask()) {
+			bad++;
+		}
+	}
+	return bad;
+}
+
+static void report(const char *what, int rows, int cols, int bad) {
+	if (bad > 0) {
+		printf("FAIL %s %dx%d: %d pixels differ from OpenCV\n", what, cols, rows, bad);
+		failures++;
+	}
+}
+
+int main() {
+	Mat kernel = getStructuringElement(MORPH_ELLIPSE, Size(5, 5));
+	mt19937 rng(1);
+	// rows and columns around the word size, and masks smaller than the kernel
+	int sizes[][2] = {{1, 1}, {3, 5}, {7, 63}, {9, 64}, {11, 65}, {20, 127}, {33, 128}, {40, 200}, {5, 130}, {480, 640}};
+
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		int rows = sizes[s][0];
+		int cols = sizes[s][1];
+		for (int round = 0; round < MORPH_ROUNDS; round++) {
+			// densities from empty to full, noise is where the border cases show up
+			int density = 1000 * (round % 5) / 4;
+			Mat mask(rows, cols, CV_8UC1);
+			for (int y = 0; y < rows; y++) {
+				uchar *p = mask.ptr<uchar>(y);
+				for (int x = 0; x < cols; x++) {
+					p[x] = (int)(rng() % 1000) < density ? 255 : 0;
+				}
+			}
+
+			BitMask bits;
+			BitMask result;
+			BitMask temp;
+			Mat expected;
+			packMask(mask, &bits);
+			report("pack", rows, cols, differences(bits, mask));
+
+			erode(mask, expected, kernel);
+			erodeMask(bits, &result);
+			report("erode", rows, cols, differences(result, expected));
+
+			dilate(mask, expected, kernel);
+			dilateMask(bits, &result);
+			report("dilate", rows, cols, differences(result, expected));
+
+			// filterMask's order, an opening then a closing
+			erode(mask, expected, kernel);
+			dilate(expected, expected, kernel);
+			dilate(expected, expected, kernel);
+			erode(expected, expected, kernel);
+			result = bits;
+			openMask(&result, &temp);
+			closeMask(&result, &temp);
+			report("open + close", rows, cols, differences(result, expected));
+		}
+	}
+
+	printf("%s: %d failures\n", failures ? "FAIL" : "PASS", failures);
+	return failures ? 1 : 0;
+}
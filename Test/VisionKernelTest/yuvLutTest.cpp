@@ -0,0 +1,122 @@
+// Checks the YUV colour table of the -y engine against the HSV path it stands
+// in for: YUYV converted to BGR like frameToBGR does, then cvtColor to HSV and
+// inRange as filterImage thresholds (its blur and cleaning left out, they would
+// mix neighbouring colours of the cube). Every Y, U and V is tried.
+//
+// The table holds each 4x4x4 bin's centre class, so a colour can only differ
+// where a range boundary splits its bin. Where the boundary is locally flat,
+// the centre lies on the larger side of the bin, so at most half of a split bin
+// differs. The tolerance follows from that, not from a measured rate.
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "../../Pascal/Vision/colorLut.h"
+
+using namespace cv;
+using namespace std;
+
+#define BIN_SHIFT (8 - LUT_BITS)
+#define BIN_COLOURS (1 << (3 * BIN_SHIFT))
+#define LEVELS (1 << LUT_BITS)
+
+static int failures = 0;
+
+// filterImage's mask, a wrapped hue range is the union of its two halves
+static void referenceMask(const Mat &hsv, const hsvRange_t &r, Mat *mask) {
+	Scalar lower = r.lowerBound;
+	Scalar upper = r.upperBound;
+	if (lower[0] <= upper[0]) {
+		inRange(hsv, lower, upper, *mask);
+		return;
+	}
+	Mat high;
+	inRange(hsv, Scalar(lower[0], lower[1], lower[2]), Scalar(179, upper[1], upper[2]), *mask);
+	inRange(hsv, Scalar(0, lower[1], lower[2]), Scalar(upper[0], upper[1], upper[2]), high);
+	bitwise_or(*mask, high, *mask);
+}
+
+int main() {
+	vector<hsvRange_t> ranges(3);
+	ranges[0].lowerBound = Scalar(5, 120, 100);		// the orange ball
+	ranges[0].upperBound = Scalar(25, 255, 255);
+	ranges[1].lowerBound = Scalar(170, 80, 60);		// red, wraps around 180
+	ranges[1].upperBound = Scalar(10, 255, 255);
+	ranges[2].lowerBound = Scalar(100, 40, 40);		// a dull blue
+	ranges[2].upperBound = Scalar(130, 200, 200);
+	int numTargets = ranges.size();
+
+	colorTargets_t targets;
+	setColorTargets(&targets, ranges, SEGMENT_YUV);
+
+	// per target and bin, how many of its colours the HSV path takes and how many the table gets wrong
+	vector<vector<uchar> > inside(numTargets, vector<uchar>(LUT_SIZE, 0));
+	vector<vector<uchar> > wrong(numTargets, vector<uchar>(LUT_SIZE, 0));
+
+	// one Y at a time, a row per U and a Y Y pair per V
+	Mat yuyv(256, 2 * 256, CV_8UC2);
+	Mat bgr;
+	Mat hsv;
+	vector<Mat> expected(numTargets);
+	vector<BitMask> masks(numTargets);
+	BitMask *dst[HSV_MAX_TARGETS];
+	for (int t = 0; t < numTargets; t++) {
+		dst[t] = &masks[t];
+	}
+	for (int luma = 0; luma < 256; luma++) {
+		for (int u = 0; u < 256; u++) {
+			uchar *p = yuyv.ptr<uchar>(u);
+			for (int v = 0; v < 256; v++, p += 4) {
+				p[0] = p[2] = luma;
+				p[1] = u;
+				p[3] = v;
+			}
+		}
+		cvtColor(yuyv, bgr, COLOR_YUV2BGR_YUYV);
+		cvtColor(bgr, hsv, COLOR_BGR2HSV);
+		targets.lut.thresholdYUYV(yuyv, dst, 0, numTargets);
+
+		for (int t = 0; t < numTargets; t++) {
+			referenceMask(hsv, ranges[t], &expected[t]);
+			for (int u = 0; u < 256; u++) {
+				const uchar *e = expected[t].ptr<uchar>(u);
+				for (int v = 0; v < 256; v++) {
+					int bin = ((luma >> BIN_SHIFT) << (2 * LUT_BITS)) | ((u >> BIN_SHIFT) << LUT_BITS) | (v >> BIN_SHIFT);
+					// both pixels of the pair are the same colour, the first one stands for it
+					bool want = e[2 * v] != 0;
+					bool got = masks[t].get(u, 2 * v);
+					inside[t][bin] += want;
+					wrong[t][bin] += want != got;
+				}
+			}
+		}
+	}
+
+	for (int t = 0; t < numTargets; t++) {
+		long differ = 0;
+		long split = 0;
+		long awayFromBoundary = 0;
+		for (int bin = 0; bin < LUT_SIZE; bin++) {
+			if (inside[t][bin] > 0 && inside[t][bin] < BIN_COLOURS) {
+				split += BIN_COLOURS;
+				differ += wrong[t][bin];
+			} else {
+				awayFromBoundary += wrong[t][bin];
+			}
+		}
+
+		printf("target %d: %ld colours differ (%.3f%% of all), %.1f%% of the %ld in split bins\n", t, differ,
+			   100.0 * differ / (1 << 24), split > 0 ? 100.0 * differ / split : 0, split);
+		if (awayFromBoundary > 0) {
+			printf("FAIL target %d: %ld colours differ in bins no boundary crosses\n", t, awayFromBoundary);
+			failures++;
+		}
+		if (2 * differ > split) {
+			printf("FAIL target %d: more than half of the split bins' colours differ\n", t);
+			failures++;
+		}
+	}
+
+	printf("%s: %d failures\n", failures ? "FAIL" : "PASS", failures);
+	return failures ? 1 : 0;
+}